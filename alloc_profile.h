@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#if defined(ROCKSDB_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#endif
+
+// Allocations of the driver thread per operation, split into the engine (inside the timed DB call)
+// and the harness (key generation, the read-key sets, the strings around the call). Two sources:
+// - built with ALLOC_PROFILE (make ALLOC_PROFILE=1), the global operator new and delete of the
+//   driver are replaced to count allocations and bytes; malloc calls are not seen
+// - built with JEMALLOC, jemalloc's per-thread allocated bytes, which include malloc but no counts
+// Both count only the calling thread, so flushes and compactions are left out.
+// The replacement operators are defined here, so include this header from one translation unit only.
+
+#if defined(ALLOC_PROFILE)
+inline thread_local uint64_t allocProfileCount = 0;
+inline thread_local uint64_t allocProfileBytes = 0;
+
+static void* allocProfileNew(std::size_t size) {
+	allocProfileCount++;
+	allocProfileBytes += size;
+	void* p = std::malloc(size == 0 ? 1 : size);
+	if (p == nullptr) {throw std::bad_alloc();}
+	return p;
+}
+
+static void* allocProfileNewAligned(std::size_t size, std::align_val_t alignment) {
+	allocProfileCount++;
+	allocProfileBytes += size;
+	std::size_t align = static_cast<std::size_t>(alignment);
+	void* p = std::aligned_alloc(align, (size + align - 1) / align * align);
+	if (p == nullptr) {throw std::bad_alloc();}
+	return p;
+}
+
+void* operator new(std::size_t size) {return allocProfileNew(size);}
+void* operator new[](std::size_t size) {return allocProfileNew(size);}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	try {return allocProfileNew(size);} catch (...) {return nullptr;}
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	try {return allocProfileNew(size);} catch (...) {return nullptr;}
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {return allocProfileNewAligned(size, alignment);}
+void* operator new[](std::size_t size, std::align_val_t alignment) {return allocProfileNewAligned(size, alignment);}
+void operator delete(void* p) noexcept {std::free(p);}
+void operator delete[](void* p) noexcept {std::free(p);}
+void operator delete(void* p, std::size_t) noexcept {std::free(p);}
+void operator delete[](void* p, std::size_t) noexcept {std::free(p);}
+void operator delete(void* p, std::align_val_t) noexcept {std::free(p);}
+void operator delete[](void* p, std::align_val_t) noexcept {std::free(p);}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {std::free(p);}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {std::free(p);}
+#endif
+
+struct AllocCounters {
+	uint64_t count = 0;
+	uint64_t bytes = 0;
+
+	static bool isAvailable() {
+#if defined(ALLOC_PROFILE) || defined(ROCKSDB_JEMALLOC)
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// whether count holds real allocation counts, jemalloc only gives bytes
+	static bool hasCounts() {
+#if defined(ALLOC_PROFILE)
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	static AllocCounters current() {
+		AllocCounters counters;
+#if defined(ALLOC_PROFILE)
+		counters.count = allocProfileCount;
+		counters.bytes = allocProfileBytes;
+#elif defined(ROCKSDB_JEMALLOC)
+		uint64_t allocated = 0;
+		size_t size = sizeof(allocated);
+		if (mallctl("thread.allocated", &allocated, &size, nullptr, 0) == 0) {counters.bytes = allocated;}
+#endif
+		return counters;
+	}
+
+	AllocCounters operator-(const AllocCounters& other) const {
+		AllocCounters diff;
+		diff.count = count - other.count;
+		diff.bytes = bytes - other.bytes;
+		return diff;
+	}
+
+	AllocCounters& operator+=(const AllocCounters& other) {
+		count += other.count;
+		bytes += other.bytes;
+		return *this;
+	}
+};
+
+// allocations of one phase: all of them, and those inside the DB calls between beginOp and endOp
+class AllocProfile {
+public:
+	explicit AllocProfile(bool isEnabled) : isEnabled_(isEnabled && AllocCounters::isAvailable()) {
+		if (isEnabled && !AllocCounters::isAvailable()) {
+			printf("Allocation profiling needs a build with ALLOC_PROFILE=1 or JEMALLOC\n");
+		}
+	}
+
+	void startPhase() {
+		if (!isEnabled_) {return;}
+		windowStart_ = AllocCounters::current();
+		total_ = AllocCounters();
+		engine_ = AllocCounters();
+		isRunning_ = true;
+	}
+
+	// freeze the phase total at the end of the timed loop, so the reports printed after it are not counted
+	void endPhase() {
+		if (!isEnabled_ || !isRunning_) {return;}
+		total_ += AllocCounters::current() - windowStart_;
+		isRunning_ = false;
+	}
+
+	// count again after endPhase, adding to the phase total
+	void resumePhase() {
+		if (!isEnabled_ || isRunning_) {return;}
+		windowStart_ = AllocCounters::current();
+		isRunning_ = true;
+	}
+
+	void beginOp() {
+		if (isEnabled_) {opStart_ = AllocCounters::current();}
+	}
+
+	void endOp() {
+		if (isEnabled_) {engine_ += AllocCounters::current() - opStart_;}
+	}
+
+	// ends the phase if it is still running
+	void print(const std::string& phase, const std::string& opName, uint64_t numOps) {
+		if (!isEnabled_) {return;}
+		endPhase();
+		AllocCounters harness = total_ - engine_;
+		double ops = numOps > 0 ? (double)numOps : 1.0;
+		if (AllocCounters::hasCounts()) {
+			printf("Allocations %s per %s: engine %.2f (%.1f bytes), harness %.2f (%.1f bytes)\n", phase.c_str(),
+				opName.c_str(), engine_.count / ops, engine_.bytes / ops, harness.count / ops, harness.bytes / ops);
+		}
+		else {
+			printf("Allocated bytes %s per %s: engine %.1f, harness %.1f\n", phase.c_str(), opName.c_str(),
+				engine_.bytes / ops, harness.bytes / ops);
+		}
+	}
+
+private:
+	bool isEnabled_;
+	bool isRunning_ = false;
+	AllocCounters windowStart_;  // since the phase started or resumed
+	AllocCounters total_;  // of the phase until the last endPhase
+	AllocCounters opStart_;
+	AllocCounters engine_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <string>
+
+// command-line options of the test drivers, given as "--name=value"
+// every option has a default, so running a driver without arguments keeps the original experiment
+class BenchFlags {
+public:
+	BenchFlags(int argc, char** argv) : argc_(argc), argv_(argv) {}
+
+	// look up a flag, return the default value if it is not given
+	std::string getString(const std::string& name, const std::string& defaultValue) {
+		used_.insert(name);
+		std::string prefix = "--" + name + "=";
+		for (int i = 1; i < argc_; i++) {
+			std::string arg = argv_[i];
+			if (arg.compare(0, prefix.length(), prefix) == 0) {return arg.substr(prefix.length());}
+		}
+		return defaultValue;
+	}
+
+	int getInt(const std::string& name, int defaultValue) {
+		std::string value = getString(name, "");
+		return value.empty() ? defaultValue : std::atoi(value.c_str());
+	}
+
+	double getDouble(const std::string& name, double defaultValue) {
+		std::string value = getString(name, "");
+		return value.empty() ? defaultValue : std::atof(value.c_str());
+	}
+
+	bool getBool(const std::string& name, bool defaultValue) {
+		std::string value = getString(name, "");
+		if (value.empty()) {return defaultValue;}
+		return value == "true" || value == "1";
+	}
+
+	// warn about flags that no driver option asked for, usually a typo
+	void reportUnknown() const {
+		for (int i = 1; i < argc_; i++) {
+			std::string arg = argv_[i];
+			std::string name = arg.substr(0, arg.find('='));
+			if (name.compare(0, 2, "--") == 0) {name = name.substr(2);}
+			if (used_.count(name) == 0) {
+				std::cout << "WARNING: unknown flag " << arg << std::endl;
+			}
+		}
+	}
+
+private:
+	int argc_;
+	char** argv_;
+	std::set<std::string> used_;
+};
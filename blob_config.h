@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/metadata.h"
+#include "rocksdb/options.h"
+
+// Key-value separation: values of at least minBlobSize bytes go to blob files and the SSTs keep
+// references, so compactions and scans over the keys stop moving the 1 KB values. A range delete
+// only makes the blobs garbage; blob garbage collection relocates the live blobs of the oldest
+// ageCutoff fraction of the blob files during compaction, and a blob file is deleted once nothing
+// references it.
+inline void configureBlobFiles(rocksdb::Options* options, bool isBlobFiles, uint64_t minBlobSize, bool isBlobGc,
+		double ageCutoff) {
+	if (!isBlobFiles) {return;}
+	options->enable_blob_files = true;
+	options->min_blob_size = minBlobSize;
+	options->enable_blob_garbage_collection = isBlobGc;
+	options->blob_garbage_collection_age_cutoff = ageCutoff;
+}
+
+// blob files of all column families, and the bytes in them that no SST references any more
+struct BlobSpace {
+	uint64_t numFiles = 0;
+	uint64_t fileBytes = 0;
+	uint64_t garbageBytes = 0;
+};
+
+inline BlobSpace getBlobSpace(rocksdb::DB* db) {
+	std::vector<rocksdb::ColumnFamilyMetaData> metas;
+	db->GetAllColumnFamilyMetaData(&metas);
+	BlobSpace space;
+	for (const rocksdb::ColumnFamilyMetaData& meta : metas) {
+		space.numFiles += meta.blob_file_count;
+		space.fileBytes += meta.blob_file_size;
+		for (const rocksdb::BlobMetaData& blob : meta.blob_files) {space.garbageBytes += blob.garbage_blob_bytes;}
+	}
+	return space;
+}
+
+// blob space next to the SST size, so inline and separated runs compare on total disk usage
+inline void printBlobSpace(rocksdb::DB* db, const std::string& info) {
+	BlobSpace space = getBlobSpace(db);
+	uint64_t sstSize = 0;
+	db->GetIntProperty(rocksdb::DB::Properties::kTotalSstFilesSize, &sstSize);
+	std::cout << "Blob files " << info << ": " << space.numFiles << " files, " << space.fileBytes << " bytes, "
+		<< space.garbageBytes << " bytes garbage" << std::endl;
+	std::cout << "Disk size (SST + blob) " << info << ": " << sstSize + space.fileBytes << " bytes" << std::endl;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "rocksdb/db.h"
+#include "rocksdb/env.h"
+#include "rocksdb/options.h"
+#include "rocksdb/trace_reader_writer.h"
+
+// Block cache access trace of one read phase, written to <dir>/<phase>.trace with the spaces of the
+// phase name replaced by underscores. Summarize a trace with cache_trace_analyzer, built with the drivers.
+
+inline std::string blockCacheTracePath(const std::string& dir, const std::string& phase) {
+	std::string name = phase;
+	for (char& c : name) {
+		if (c == ' ') {c = '_';}
+	}
+	return dir + "/" + name + ".trace";
+}
+
+inline rocksdb::Status startBlockCacheTrace(rocksdb::DB* db, const std::string& dir, const std::string& phase) {
+	rocksdb::Status s = db->GetEnv()->CreateDirIfMissing(dir);
+	if (!s.ok()) {return s;}
+	std::unique_ptr<rocksdb::TraceWriter> traceWriter;
+	s = rocksdb::NewFileTraceWriter(db->GetEnv(), rocksdb::EnvOptions(), blockCacheTracePath(dir, phase), &traceWriter);
+	if (!s.ok()) {return s;}
+	rocksdb::TraceOptions traceOptions;  // every access, no sampling
+	return db->StartBlockCacheTrace(traceOptions, std::move(traceWriter));
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if !defined(OS_WIN)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "rocksdb/cache.h"
+#include "rocksdb/db.h"
+#include "rocksdb/metadata.h"
+#include "rocksdb/options.h"
+#include "rocksdb/table.h"
+
+// Cache temperature of the read phases. Both modes empty the block cache and drop the SST pages
+// from the OS page cache before each phase, so no phase inherits the state left by the one before
+// or by an earlier run. "cold" then reads right away with direct reads, measuring cold-start cost;
+// "warm" runs the warm-up queries first, measuring steady-state cost. Empty keeps the old behavior.
+
+// cold reads bypass the page cache, and index and filter blocks go through the block cache so that
+// emptying it makes them cold too; the block cache is created here when the driver did not pick one
+inline rocksdb::Status configureCacheMode(rocksdb::Options* options, rocksdb::BlockBasedTableOptions* tableOptions,
+		const std::string& cacheMode) {
+	if (cacheMode.empty()) {return rocksdb::Status::OK();}
+	if (cacheMode == "cold") {
+		options->use_direct_reads = true;
+		tableOptions->cache_index_and_filter_blocks = true;
+	}
+	else if (cacheMode != "warm") {
+		return rocksdb::Status::InvalidArgument("unknown cache mode: " + cacheMode);
+	}
+	if (tableOptions->block_cache == nullptr) {tableOptions->block_cache = rocksdb::NewLRUCache(8 << 20);}
+	return rocksdb::Status::OK();
+}
+
+struct CacheResetResult {
+	uint64_t blockCacheBefore = 0;  // block cache usage before and after, pinned blocks stay
+	uint64_t blockCacheAfter = 0;
+	int numFilesEvicted = 0;  // SST files dropped from the page cache
+};
+
+// drop the page cache of a file, dirty pages are written first since only clean ones can be dropped
+inline bool evictFromPageCache(const std::string& path) {
+#if defined(OS_WIN)
+	return false;
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {return false;}
+	fdatasync(fd);
+	bool isEvicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(fd);
+	return isEvicted;
+#endif
+}
+
+// empty the block cache and evict the live SST files of all column families from the page cache
+inline CacheResetResult resetCaches(rocksdb::DB* db, rocksdb::Cache* blockCache) {
+	CacheResetResult result;
+	result.blockCacheBefore = blockCache->GetUsage();
+	blockCache->EraseUnRefEntries();
+	result.blockCacheAfter = blockCache->GetUsage();
+	std::vector<rocksdb::LiveFileMetaData> files;
+	db->GetLiveFilesMetaData(&files);
+	for (const rocksdb::LiveFileMetaData& file : files) {
+		if (evictFromPageCache(file.db_path + file.name)) {result.numFilesEvicted++;}
+	}
+	return result;
+}
+
+inline void printCacheReset(const CacheResetResult& result, const std::string& info) {
+	std::cout << "Caches reset " << info << ": block cache " << result.blockCacheBefore << " -> "
+		<< result.blockCacheAfter << " bytes, " << result.numFilesEvicted << " SST files evicted from the page cache" << std::endl;
+}
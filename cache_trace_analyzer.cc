@@ -0,0 +1,127 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <iostream>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+
+#include "rocksdb/env.h"
+#include "rocksdb/trace_reader_writer.h"
+#include "trace_replay/block_cache_tracer.h"
+
+using ROCKSDB_NAMESPACE::BlockCacheTraceHeader;
+using ROCKSDB_NAMESPACE::BlockCacheTraceReader;
+using ROCKSDB_NAMESPACE::BlockCacheTraceRecord;
+using ROCKSDB_NAMESPACE::Status;
+using ROCKSDB_NAMESPACE::TraceReader;
+using ROCKSDB_NAMESPACE::TraceType;
+
+// Summary of a block cache trace written by the test drivers (block_cache_trace_dir):
+// accesses and recorded hit ratio by block type and level, and a miss ratio curve from
+// simulating an LRU cache of each given size over the same accesses.
+// usage: ./cache_trace_analyzer <trace file> [cache size in MB]...
+// built from the examples directory of a RocksDB checkout, it uses the internal trace reader
+
+std::string blockTypeName(TraceType type) {
+	switch (type) {
+		case TraceType::kBlockTraceDataBlock: return "data";
+		case TraceType::kBlockTraceIndexBlock: return "index";
+		case TraceType::kBlockTraceFilterBlock: return "filter";
+		case TraceType::kBlockTraceRangeDeletionBlock: return "range-del";
+		case TraceType::kBlockTraceUncompressionDictBlock: return "dictionary";
+		default: return "other";
+	}
+}
+
+// LRU cache charged by block size, only the keys are kept
+class SimulatedLru {
+public:
+	explicit SimulatedLru(uint64_t capacity) : capacity_(capacity) {}
+
+	// return whether the access hits; a miss inserts the block unless the access asked not to
+	bool access(const std::string& key, uint64_t size, bool isInsert) {
+		auto it = index_.find(key);
+		if (it != index_.end()) {
+			entries_.splice(entries_.begin(), entries_, it->second);
+			return true;
+		}
+		if (!isInsert || size > capacity_) {return false;}
+		entries_.emplace_front(key, size);
+		index_[key] = entries_.begin();
+		usage_ += size;
+		while (usage_ > capacity_) {
+			usage_ -= entries_.back().second;
+			index_.erase(entries_.back().first);
+			entries_.pop_back();
+		}
+		return false;
+	}
+
+private:
+	uint64_t capacity_;
+	uint64_t usage_ = 0;
+	std::list<std::pair<std::string, uint64_t>> entries_;  // most recently used first
+	std::unordered_map<std::string, std::list<std::pair<std::string, uint64_t>>::iterator> index_;
+};
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cout << "usage: " << argv[0] << " <trace file> [cache size in MB]..." << std::endl;
+		return 1;
+	}
+	std::vector<uint64_t> cacheSizesMb;
+	for (int i = 2; i < argc; i++) {cacheSizesMb.push_back(std::strtoull(argv[i], nullptr, 10));}
+	if (cacheSizesMb.empty()) {cacheSizesMb = {8, 16, 32, 64, 128, 256, 512, 1024, 2048};}
+
+	std::unique_ptr<TraceReader> traceReader;
+	Status s = ROCKSDB_NAMESPACE::NewFileTraceReader(ROCKSDB_NAMESPACE::Env::Default(), ROCKSDB_NAMESPACE::EnvOptions(),
+		argv[1], &traceReader);
+	if (!s.ok()) {
+		std::cout << "Cannot open the trace: " << s.ToString() << std::endl;
+		return 1;
+	}
+	BlockCacheTraceReader reader(std::move(traceReader));
+	BlockCacheTraceHeader header;
+	s = reader.ReadHeader(&header);
+	if (!s.ok()) {
+		std::cout << "Cannot read the trace header: " << s.ToString() << std::endl;
+		return 1;
+	}
+
+	// accesses and hits by (block type, level)
+	std::map<std::pair<std::string, int>, std::pair<uint64_t, uint64_t>> byTypeAndLevel;
+	std::vector<SimulatedLru> caches;
+	for (uint64_t sizeMb : cacheSizesMb) {caches.emplace_back(sizeMb << 20);}
+	std::vector<uint64_t> simulatedMisses(caches.size(), 0);
+	uint64_t numAccesses = 0;
+	BlockCacheTraceRecord record;
+	while (reader.ReadAccess(&record).ok()) {
+		numAccesses++;
+		bool isHit = static_cast<bool>(record.is_cache_hit);
+		bool isInsert = !static_cast<bool>(record.no_insert);
+		std::pair<uint64_t, uint64_t>& counts = byTypeAndLevel[std::make_pair(blockTypeName(record.block_type), (int)record.level)];
+		counts.first++;
+		if (isHit) {counts.second++;}
+		for (size_t i = 0; i < caches.size(); i++) {
+			if (!caches[i].access(record.block_key, record.block_size, isInsert)) {simulatedMisses[i]++;}
+		}
+	}
+
+	std::cout << "Accesses: " << numAccesses << std::endl;
+	std::cout << "Accesses by block type and level:" << std::endl;
+	for (auto& entry : byTypeAndLevel) {
+		uint64_t accesses = entry.second.first;
+		printf("  %s L%d: %llu accesses (%.2f percent), hit ratio %.4f\n", entry.first.first.c_str(), entry.first.second,
+			(unsigned long long)accesses, numAccesses > 0 ? accesses * 100.0 / numAccesses : 0.0,
+			(double)entry.second.second / accesses);
+	}
+	std::cout << "Simulated LRU miss ratio curve:" << std::endl;
+	for (size_t i = 0; i < caches.size(); i++) {
+		printf("  %llu MB: miss ratio %.4f\n", (unsigned long long)cacheSizesMb[i],
+			numAccesses > 0 ? (double)simulatedMisses[i] / numAccesses : 0.0);
+	}
+	return 0;
+}
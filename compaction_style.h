@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "rocksdb/db.h"
+#include "rocksdb/listener.h"
+#include "rocksdb/options.h"
+
+// Compaction style matrix: run the same load, delete and read sequence under leveled, universal,
+// FIFO or no compaction, with auto compactions on, and compare how each style recovers.
+
+// set the compaction style by name and turn auto compactions on
+// FIFO deletes the oldest files above fifoMaxBytes, so keep that larger than the dataset
+inline rocksdb::Status applyCompactionStyle(rocksdb::Options* options, const std::string& style, uint64_t fifoMaxBytes) {
+	if (style == "level") {
+		options->compaction_style = rocksdb::kCompactionStyleLevel;
+	}
+	else if (style == "universal") {
+		options->compaction_style = rocksdb::kCompactionStyleUniversal;
+	}
+	else if (style == "fifo") {
+		options->compaction_style = rocksdb::kCompactionStyleFIFO;
+		options->compaction_options_fifo.max_table_files_size = fifoMaxBytes;
+	}
+	else if (style == "none") {
+		options->compaction_style = rocksdb::kCompactionStyleNone;
+	}
+	else {
+		return rocksdb::Status::InvalidArgument("unknown compaction style: " + style);
+	}
+	options->disable_auto_compactions = false;
+	return rocksdb::Status::OK();
+}
+
+// bytes written by flushes and compactions since the DB was opened, for the write amplification
+class WriteAmpListener : public rocksdb::EventListener {
+public:
+	// the size comes with the creation event, the flushed file may already be compacted away
+	// by the time OnFlushCompleted runs
+	void OnTableFileCreated(const rocksdb::TableFileCreationInfo& info) override {
+		if (info.reason == rocksdb::TableFileCreationReason::kFlush && info.status.ok()) {flushBytes_ += info.file_size;}
+	}
+
+	void OnCompactionCompleted(rocksdb::DB* /*db*/, const rocksdb::CompactionJobInfo& info) override {
+		compactionBytes_ += info.stats.total_output_bytes;
+	}
+
+	uint64_t flushBytes() const {return flushBytes_;}
+	uint64_t compactionBytes() const {return compactionBytes_;}
+
+private:
+	std::atomic<uint64_t> flushBytes_{0};
+	std::atomic<uint64_t> compactionBytes_{0};
+};
+
+// wait until no flush or compaction is pending or running, at most maxSeconds
+// return the time waited
+inline double waitForCompactions(rocksdb::DB* db, int maxSeconds) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while (std::chrono::steady_clock::now() - start < std::chrono::seconds(maxSeconds)) {
+		uint64_t pending = 0;
+		uint64_t runningCompactions = 0;
+		uint64_t runningFlushes = 0;
+		db->GetIntProperty(rocksdb::DB::Properties::kCompactionPending, &pending);
+		db->GetIntProperty(rocksdb::DB::Properties::kNumRunningCompactions, &runningCompactions);
+		db->GetIntProperty(rocksdb::DB::Properties::kNumRunningFlushes, &runningFlushes);
+		if (pending == 0 && runningCompactions == 0 && runningFlushes == 0) {break;}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+	std::chrono::duration<double> waited = std::chrono::steady_clock::now() - start;
+	return waited.count();
+}
+
+// space amplification is the SST size over RocksDB's estimate of the live data,
+// write amplification the bytes flushed and compacted over the bytes the test wrote
+inline void printCompactionStyleSummary(rocksdb::DB* db, const std::string& style, const std::string& info,
+		uint64_t userBytes, const WriteAmpListener& listener) {
+	uint64_t sstSize = 0;
+	uint64_t liveDataSize = 0;
+	db->GetIntProperty(rocksdb::DB::Properties::kTotalSstFilesSize, &sstSize);
+	db->GetIntProperty(rocksdb::DB::Properties::kEstimateLiveDataSize, &liveDataSize);
+	uint64_t diskBytes = listener.flushBytes() + listener.compactionBytes();
+	std::cout << "Compaction style " << style << " " << info << ":" << std::endl;
+	std::cout << "  SST size: " << sstSize << " bytes, estimated live data: " << liveDataSize << " bytes" << std::endl;
+	printf("  Space amplification: %.3f\n", liveDataSize > 0 ? (double)sstSize / liveDataSize : 0.0);
+	std::cout << "  Flushed: " << listener.flushBytes() << " bytes, compacted: " << listener.compactionBytes() << " bytes" << std::endl;
+	printf("  Write amplification: %.3f\n", userBytes > 0 ? (double)diskBytes / userBytes : 0.0);
+}
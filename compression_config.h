@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "rocksdb/advanced_options.h"
+#include "rocksdb/options.h"
+#include "rocksdb/perf_context.h"
+
+// Compression matrix: one compression type for all levels, or one per level, on values whose
+// compressibility is chosen instead of always being random strings.
+
+// "none", "snappy", "lz4", "zstd" or "zstd_dict", the last is ZSTD with a trained dictionary
+inline rocksdb::Status parseCompression(const std::string& name, rocksdb::CompressionType* type, bool* isDictionary) {
+	*isDictionary = false;
+	if (name == "none") {*type = rocksdb::kNoCompression;}
+	else if (name == "snappy") {*type = rocksdb::kSnappyCompression;}
+	else if (name == "lz4") {*type = rocksdb::kLZ4Compression;}
+	else if (name == "zstd") {*type = rocksdb::kZSTD;}
+	else if (name == "zstd_dict") {
+		*type = rocksdb::kZSTD;
+		*isDictionary = true;
+	}
+	else {return rocksdb::Status::InvalidArgument("unknown compression: " + name);}
+	return rocksdb::Status::OK();
+}
+
+// compression sets every level, perLevel is a comma-separated list from L0 down, the last entry
+// covering the remaining levels; both empty keep the per-level compression OptimizeLevelStyleCompaction chose,
+// giving both is rejected
+// dictionary settings are per column family, so one zstd_dict entry turns them on for every ZSTD level
+inline rocksdb::Status configureCompression(rocksdb::Options* options, const std::string& compression, const std::string& perLevel) {
+	if (!compression.empty() && !perLevel.empty()) {
+		return rocksdb::Status::InvalidArgument("compression and compression_per_level are exclusive");
+	}
+	std::vector<std::string> names;
+	if (!perLevel.empty()) {
+		size_t start = 0;
+		while (start <= perLevel.size()) {
+			size_t comma = perLevel.find(',', start);
+			if (comma == std::string::npos) {comma = perLevel.size();}
+			names.push_back(perLevel.substr(start, comma - start));
+			start = comma + 1;
+		}
+	}
+	else if (!compression.empty()) {
+		names.push_back(compression);
+	}
+	if (names.empty()) {return rocksdb::Status::OK();}
+	options->compression_per_level.clear();
+	bool isAnyDictionary = false;
+	for (int level = 0; level < options->num_levels; level++) {
+		rocksdb::CompressionType type;
+		bool isDictionary;
+		rocksdb::Status s = parseCompression(names[level < (int)names.size() ? level : names.size() - 1], &type, &isDictionary);
+		if (!s.ok()) {return s;}
+		options->compression_per_level.push_back(type);
+		isAnyDictionary = isAnyDictionary || isDictionary;
+	}
+	options->compression = options->compression_per_level.back();
+	if (isAnyDictionary) {
+		options->compression_opts.max_dict_bytes = 16 << 10;
+		options->compression_opts.zstd_max_train_bytes = 100 * options->compression_opts.max_dict_bytes;
+	}
+	return rocksdb::Status::OK();
+}
+
+// a value of len characters that compresses to about ratio of its size, like db_bench's values:
+// a random piece of len * ratio characters repeated; a ratio of 1 or more is fully random
+inline std::string compressibleString(const int len, double ratio) {
+	static const char characters[] =
+		"0123456789"
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		"abcdefghijklmnopqrstuvwxyz";
+	int randomLen = ratio >= 1.0 ? len : (int)(len * ratio);
+	if (randomLen < 1) {randomLen = 1;}
+	std::string piece;
+	piece.reserve(randomLen);
+	for (int i = 0; i < randomLen; i++) {
+		piece += characters[rand() % (sizeof(characters) - 1)];
+	}
+	std::string result;
+	result.reserve(len);
+	while ((int)result.size() < len) {result += piece;}
+	result.resize(len);
+	return result;
+}
+
+// block decompression time of the reading thread, in seconds; take it before and after a phase
+inline double decompressSeconds() {
+	return rocksdb::get_perf_context()->block_decompress_time / 1e9;
+}
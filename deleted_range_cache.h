@@ -0,0 +1,284 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/snapshot.h"
+#include "rocksdb/utilities/stackable_db.h"
+#include "rocksdb/write_batch.h"
+
+// A Get on a key covered by a range delete walks the memtables, filters and range-del blocks
+// only to return NotFound. The cache remembers recently issued DeleteRange intervals and answers
+// those Gets directly. Each interval is tagged with sequence numbers, so a key written after the
+// delete, or a read at an older snapshot, still goes to the LSM.
+
+// the newest cached range deletes as disjoint fragments, like RocksDB fragments range tombstones
+class RangeTombstoneCache {
+public:
+	explicit RangeTombstoneCache(size_t capacity) : capacity_(capacity) {}
+
+	// call before the delete of [start, end) is issued, so writes finishing before add() are remembered
+	void beginDelete(const std::string& start, const std::string& end) {
+		std::unique_lock<std::shared_mutex> lock(mutex_);
+		pendingDeletes_.emplace(start, end);
+	}
+
+	// the delete begun for [start, end) failed or is not cached
+	void cancelDelete(const std::string& start, const std::string& end) {
+		std::unique_lock<std::shared_mutex> lock(mutex_);
+		erasePending(start, end);
+	}
+
+	// cache [start, end) deleted at a sequence number in [seqLow, seqHigh], ending its beginDelete
+	// the delete is newer than all cached fragments, so it replaces the parts it overlaps
+	// seqLow > seqHigh means the delete consumed no sequence number and cannot be tagged, so it is not cached
+	void add(const std::string& start, const std::string& end, uint64_t seqLow, uint64_t seqHigh) {
+		std::unique_lock<std::shared_mutex> lock(mutex_);
+		erasePending(start, end);
+		if (start >= end || capacity_ == 0 || seqLow > seqHigh) {return;}
+		auto it = fragments_.upper_bound(start);
+		if (it != fragments_.begin() && std::prev(it)->second.end > start) {--it;}
+		std::vector<std::pair<std::string, Fragment>> remainders;
+		while (it != fragments_.end() && it->first < end) {
+			if (it->first < start) {remainders.push_back({it->first, Fragment{start, it->second.seqLow, it->second.seqHigh}});}
+			if (it->second.end > end) {remainders.push_back({end, it->second});}
+			it = fragments_.erase(it);
+		}
+		for (auto& remainder : remainders) {fragments_[remainder.first] = remainder.second;}
+		fragments_[start] = Fragment{end, seqLow, seqHigh};
+		// writes older than this delete no longer matter inside the interval, ones that may be newer stay
+		for (auto write = reinserted_.lower_bound(start); write != reinserted_.end() && write->first < end;) {
+			write = write->second <= seqLow ? reinserted_.erase(write) : std::next(write);
+		}
+		while (fragments_.size() > capacity_) {evictOldest();}
+	}
+
+	// call before a write to the key is published, so no Get answers from the cache while it is in flight
+	void beginWrite(const rocksdb::Slice& key) {
+		std::unique_lock<std::shared_mutex> lock(mutex_);
+		inFlight_[key.ToString()]++;
+	}
+
+	// call once the write is published or has failed, seqHigh bounds its sequence number from above
+	// a key covered by a cached delete, or by one not cached yet, is remembered as possibly re-inserted
+	void endWrite(const rocksdb::Slice& key, uint64_t seqHigh) {
+		std::unique_lock<std::shared_mutex> lock(mutex_);
+		std::string_view keyView(key.data(), key.size());
+		auto pending = inFlight_.find(keyView);
+		if (pending != inFlight_.end() && --pending->second == 0) {inFlight_.erase(pending);}
+		if (findCovering(key) == fragments_.end() && !isPendingDeleted(keyView)) {return;}
+		auto write = reinserted_.find(keyView);
+		if (write == reinserted_.end()) {reinserted_[key.ToString()] = seqHigh;}
+		else if (write->second < seqHigh) {write->second = seqHigh;}
+	}
+
+	// whether a read at snapshotSeq can answer NotFound without touching the LSM
+	bool isDeleted(const rocksdb::Slice& key, uint64_t snapshotSeq) const {
+		std::shared_lock<std::shared_mutex> lock(mutex_);
+		auto it = findCovering(key);
+		if (it == fragments_.end()) {return false;}
+		// the snapshot may predate the delete
+		if (snapshotSeq < it->second.seqHigh) {return false;}
+		// the key may have been written after the delete, or is being written right now
+		std::string_view keyView(key.data(), key.size());
+		if (inFlight_.find(keyView) != inFlight_.end()) {return false;}
+		auto write = reinserted_.find(keyView);
+		if (write != reinserted_.end() && write->second > it->second.seqLow) {return false;}
+		return true;
+	}
+
+	size_t size() const {
+		std::shared_lock<std::shared_mutex> lock(mutex_);
+		return fragments_.size();
+	}
+
+private:
+	struct Fragment {
+		std::string end;
+		uint64_t seqLow;  // the delete's sequence number is at least this
+		uint64_t seqHigh;  // and at most this
+	};
+
+	// caller must hold the mutex
+	std::map<std::string, Fragment, std::less<>>::const_iterator findCovering(const rocksdb::Slice& key) const {
+		std::string_view keyView(key.data(), key.size());
+		auto it = fragments_.upper_bound(keyView);
+		if (it == fragments_.begin()) {return fragments_.end();}
+		--it;
+		return keyView < it->second.end ? it : fragments_.end();
+	}
+
+	// caller must hold the mutex
+	bool isPendingDeleted(std::string_view key) const {
+		for (const auto& range : pendingDeletes_) {
+			if (range.first <= key && key < range.second) {return true;}
+		}
+		return false;
+	}
+
+	// caller must hold the mutex
+	void erasePending(const std::string& start, const std::string& end) {
+		auto range = pendingDeletes_.equal_range(start);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second == end) {
+				pendingDeletes_.erase(it);
+				return;
+			}
+		}
+	}
+
+	// caller must hold the mutex
+	void evictOldest() {
+		auto oldest = fragments_.begin();
+		for (auto it = fragments_.begin(); it != fragments_.end(); ++it) {
+			if (it->second.seqHigh < oldest->second.seqHigh) {oldest = it;}
+		}
+		reinserted_.erase(reinserted_.lower_bound(oldest->first), reinserted_.lower_bound(oldest->second.end));
+		fragments_.erase(oldest);
+	}
+
+	size_t capacity_;  // maximum number of fragments
+	mutable std::shared_mutex mutex_;
+	std::map<std::string, Fragment, std::less<>> fragments_;
+	std::map<std::string, uint64_t, std::less<>> reinserted_;  // covered keys written again
+	std::map<std::string, int, std::less<>> inFlight_;  // keys with unpublished writes, and how many
+	std::multimap<std::string, std::string> pendingDeletes_;  // deletes issued but not cached yet, start to end
+};
+
+// DB wrapper answering Gets on keys covered by a recent DeleteRange of the default column family
+// the sequence numbers are read around each write instead of serializing the writers, so the
+// tags are bounds; every uncertain case falls back to the LSM, including a key whose write is
+// still in flight or finished while a covering delete was in flight
+// it must wrap the base DB directly: a lazy or partitioned DB below it deletes without a tombstone,
+// so its deletes have no sequence number to order them against the writes
+class DeletedRangeCacheDB : public rocksdb::StackableDB {
+public:
+	DeletedRangeCacheDB(rocksdb::DB* db, size_t capacity) : rocksdb::StackableDB(db), cache_(capacity) {}
+
+	using rocksdb::StackableDB::Get;
+	using rocksdb::StackableDB::Put;
+	using rocksdb::StackableDB::Merge;
+	using rocksdb::StackableDB::DeleteRange;
+
+	rocksdb::Status Get(const rocksdb::ReadOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+			const rocksdb::Slice& key, rocksdb::PinnableSlice* value) override {
+		if (isDefault(column_family)) {
+			uint64_t snapshotSeq = options.snapshot != nullptr ? options.snapshot->GetSequenceNumber()
+				: std::numeric_limits<uint64_t>::max();
+			if (cache_.isDeleted(key, snapshotSeq)) {
+				numShortCircuited_++;
+				return rocksdb::Status::NotFound();
+			}
+		}
+		return rocksdb::StackableDB::Get(options, column_family, key, value);
+	}
+
+	rocksdb::Status Put(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+			const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+		if (!isDefault(column_family)) {return rocksdb::StackableDB::Put(options, column_family, key, value);}
+		cache_.beginWrite(key);
+		rocksdb::Status s = rocksdb::StackableDB::Put(options, column_family, key, value);
+		cache_.endWrite(key, GetLatestSequenceNumber());
+		return s;
+	}
+
+	rocksdb::Status Merge(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+			const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+		if (!isDefault(column_family)) {return rocksdb::StackableDB::Merge(options, column_family, key, value);}
+		cache_.beginWrite(key);
+		rocksdb::Status s = rocksdb::StackableDB::Merge(options, column_family, key, value);
+		cache_.endWrite(key, GetLatestSequenceNumber());
+		return s;
+	}
+
+	rocksdb::Status DeleteRange(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+			const rocksdb::Slice& begin_key, const rocksdb::Slice& end_key) override {
+		if (!isDefault(column_family)) {
+			return rocksdb::StackableDB::DeleteRange(options, column_family, begin_key, end_key);
+		}
+		std::string begin = begin_key.ToString();
+		std::string end = end_key.ToString();
+		cache_.beginDelete(begin, end);
+		uint64_t seqLow = GetLatestSequenceNumber() + 1;
+		rocksdb::Status s = rocksdb::StackableDB::DeleteRange(options, column_family, begin_key, end_key);
+		if (s.ok()) {cache_.add(begin, end, seqLow, GetLatestSequenceNumber());}
+		else {cache_.cancelDelete(begin, end);}
+		return s;
+	}
+
+	rocksdb::Status Write(const rocksdb::WriteOptions& options, rocksdb::WriteBatch* updates) override {
+		BatchHandler beginHandler(&cache_, false, false, 0, 0);
+		rocksdb::Status s = updates->Iterate(&beginHandler);
+		if (!s.ok()) {return s;}
+		uint64_t seqLow = GetLatestSequenceNumber() + 1;
+		rocksdb::Status writeStatus = rocksdb::StackableDB::Write(options, updates);
+		// the in-flight marks and pending deletes are cleared even if the write failed
+		BatchHandler endHandler(&cache_, true, writeStatus.ok(), seqLow, GetLatestSequenceNumber());
+		s = updates->Iterate(&endHandler);
+		return writeStatus.ok() ? s : writeStatus;
+	}
+
+	uint64_t numShortCircuited() const {return numShortCircuited_;}
+	size_t numCachedRanges() const {return cache_.size();}
+
+private:
+	// walks a batch before it is written to mark its writes and deletes in flight, and after to publish them
+	class BatchHandler : public rocksdb::WriteBatch::Handler {
+	public:
+		BatchHandler(RangeTombstoneCache* cache, bool isWritten, bool isPublished, uint64_t seqLow, uint64_t seqHigh)
+			: cache_(cache), isWritten_(isWritten), isPublished_(isPublished), seqLow_(seqLow), seqHigh_(seqHigh) {}
+		rocksdb::Status PutCF(uint32_t column_family_id, const rocksdb::Slice& key,
+				const rocksdb::Slice& /*value*/) override {
+			if (column_family_id == 0) {noteWrite(key);}
+			return rocksdb::Status::OK();
+		}
+		rocksdb::Status MergeCF(uint32_t column_family_id, const rocksdb::Slice& key,
+				const rocksdb::Slice& /*value*/) override {
+			if (column_family_id == 0) {noteWrite(key);}
+			return rocksdb::Status::OK();
+		}
+		// the delete is cached only once it is published
+		rocksdb::Status DeleteRangeCF(uint32_t column_family_id, const rocksdb::Slice& begin_key,
+				const rocksdb::Slice& end_key) override {
+			if (column_family_id != 0) {return rocksdb::Status::OK();}
+			if (!isWritten_) {cache_->beginDelete(begin_key.ToString(), end_key.ToString());}
+			else if (isPublished_) {cache_->add(begin_key.ToString(), end_key.ToString(), seqLow_, seqHigh_);}
+			else {cache_->cancelDelete(begin_key.ToString(), end_key.ToString());}
+			return rocksdb::Status::OK();
+		}
+		// the default handler rejects these, a point delete cannot make a cached key visible
+		rocksdb::Status DeleteCF(uint32_t /*column_family_id*/, const rocksdb::Slice& /*key*/) override {
+			return rocksdb::Status::OK();
+		}
+		rocksdb::Status SingleDeleteCF(uint32_t /*column_family_id*/, const rocksdb::Slice& /*key*/) override {
+			return rocksdb::Status::OK();
+		}
+	private:
+		void noteWrite(const rocksdb::Slice& key) {
+			if (isWritten_) {cache_->endWrite(key, seqHigh_);}
+			else {cache_->beginWrite(key);}
+		}
+
+		RangeTombstoneCache* cache_;
+		bool isWritten_;
+		bool isPublished_;
+		uint64_t seqLow_;
+		uint64_t seqHigh_;
+	};
+
+	bool isDefault(rocksdb::ColumnFamilyHandle* column_family) const {
+		return column_family == nullptr || column_family->GetID() == 0;
+	}
+
+	RangeTombstoneCache cache_;
+	std::atomic<uint64_t> numShortCircuited_{0};
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware counters of the driver thread per phase, through perf_event_open: cycles, instructions,
+// LLC misses, branch misses and dTLB misses. Events the CPU or the perf_event_paranoid setting refuse
+// are skipped; with no hardware event at all, software events (task clock, page faults, context
+// switches) are counted instead. Only the calling thread is counted, so background flushes and
+// compactions are not included, but the harness code around each operation is.
+
+class HwCounters {
+public:
+	explicit HwCounters(bool isEnabled) {
+		if (!isEnabled) {return;}
+#if defined(__linux__)
+		openEvent("cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+		openEvent("instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+		openEvent("llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+		openEvent("branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+		openEvent("dtlb_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+		isHardware_ = !counters_.empty();
+		if (!isHardware_) {
+			openEvent("task_clock_ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+			openEvent("page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+			openEvent("context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+		}
+		if (counters_.empty()) {printf("perf_event_open is not available, no hardware counters\n");}
+		else if (!isHardware_) {printf("Hardware counters are not available, counting software events\n");}
+#endif
+	}
+
+	~HwCounters() {
+#if defined(__linux__)
+		for (Counter& counter : counters_) {close(counter.fd);}
+#endif
+	}
+
+	HwCounters(const HwCounters&) = delete;
+	HwCounters& operator=(const HwCounters&) = delete;
+
+	void start() {
+#if defined(__linux__)
+		for (Counter& counter : counters_) {
+			ioctl(counter.fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(counter.fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+		isRunning_ = !counters_.empty();
+	}
+
+	// stop counting at the end of the timed loop, so the reports printed after it are not counted
+	void stop() {
+		if (!isRunning_) {return;}
+		values_.clear();
+		for (Counter& counter : counters_) {values_.push_back(readAndDisable(counter));}
+		isRunning_ = false;
+	}
+
+	// count again after a stop, adding to the counts since start()
+	void resume() {
+#if defined(__linux__)
+		for (Counter& counter : counters_) {ioctl(counter.fd, PERF_EVENT_IOC_ENABLE, 0);}
+#endif
+		isRunning_ = !counters_.empty();
+	}
+
+	// print per operation, with the instructions per cycle; stops the counters if they still run
+	void print(const std::string& phase, const std::string& opName, uint64_t numOps) {
+		if (counters_.empty()) {return;}
+		stop();
+		if (values_.size() != counters_.size()) {return;}  // never started
+		double ops = numOps > 0 ? (double)numOps : 1.0;
+		printf("%s counters %s (%llu %s):", isHardware_ ? "Hardware" : "Software", phase.c_str(),
+			(unsigned long long)numOps, opName.c_str());
+		double cycles = 0.0;
+		double instructions = 0.0;
+		for (size_t i = 0; i < counters_.size(); i++) {
+			printf(" %s %.1f,", counters_[i].name, values_[i] / ops);
+			if (std::strcmp(counters_[i].name, "cycles") == 0) {cycles = values_[i];}
+			if (std::strcmp(counters_[i].name, "instructions") == 0) {instructions = values_[i];}
+		}
+		printf(" per %s", opName.c_str());
+		if (cycles > 0.0 && instructions > 0.0) {printf(", IPC %.3f", instructions / cycles);}
+		printf("\n");
+	}
+
+private:
+	struct Counter {
+		const char* name;
+		int fd;
+	};
+
+#if defined(__linux__)
+	void openEvent(const char* name, uint32_t type, uint64_t config) {
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		// the counters are multiplexed when there are more events than registers, scale by the time counted
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		if (fd >= 0) {counters_.push_back(Counter{name, fd});}
+	}
+#endif
+
+	// the count since the last reset, scaled up for the time the event was multiplexed out
+	double readAndDisable(Counter& counter) {
+#if defined(__linux__)
+		ioctl(counter.fd, PERF_EVENT_IOC_DISABLE, 0);
+		uint64_t data[3] = {0, 0, 0};  // value, time enabled, time running
+		if (read(counter.fd, data, sizeof(data)) != (ssize_t)sizeof(data) || data[2] == 0) {return 0.0;}
+		return (double)data[0] * data[1] / data[2];
+#else
+		return 0.0;
+#endif
+	}
+
+	std::vector<Counter> counters_;
+	std::vector<double> values_;  // the counts read by the last stop()
+	bool isHardware_ = false;
+	bool isRunning_ = false;
+};
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/env.h"
+#include "rocksdb/file_system.h"
+#include "rocksdb/metadata.h"
+
+// I/O accounting: a FileSystemWrapper that counts reads, read bytes and read latency of every file
+// it opens, and the bytes written. At report time the counts are grouped by file type (SST, WAL,
+// MANIFEST, blob, other) and the SST reads by the level the file is on now; files compacted away
+// meanwhile fall into "deleted". Reads served from mmap (PlainTable) bypass the file system.
+// Install it with options.env = NewCompositeEnv(fs); the Env must outlive the DB.
+
+// read latency in power-of-two microsecond buckets
+class LatencyHistogram {
+public:
+	static const int kNumBuckets = 32;
+
+	void add(uint64_t micros) {
+		int bucket = 0;
+		while (bucket < kNumBuckets - 1 && (1ull << bucket) <= micros) {bucket++;}
+		buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void addTo(std::vector<uint64_t>* counts) const {
+		counts->resize(kNumBuckets, 0);
+		for (int i = 0; i < kNumBuckets; i++) {(*counts)[i] += buckets_[i].load(std::memory_order_relaxed);}
+	}
+
+	void reset() {
+		for (std::atomic<uint64_t>& bucket : buckets_) {bucket.store(0, std::memory_order_relaxed);}
+	}
+
+	// upper bound in microseconds of the bucket holding the given fraction of the counts
+	static uint64_t percentile(const std::vector<uint64_t>& counts, double fraction) {
+		uint64_t total = 0;
+		for (uint64_t count : counts) {total += count;}
+		if (total == 0) {return 0;}
+		uint64_t seen = 0;
+		for (size_t i = 0; i < counts.size(); i++) {
+			seen += counts[i];
+			if (seen >= fraction * total) {return 1ull << i;}
+		}
+		return 1ull << (counts.size() - 1);
+	}
+
+private:
+	std::atomic<uint64_t> buckets_[kNumBuckets] = {};
+};
+
+// counters of one file, shared by the wrapped file and the file system
+struct FileIoStats {
+	std::atomic<uint64_t> numReads{0};
+	std::atomic<uint64_t> bytesRead{0};
+	std::atomic<uint64_t> readMicros{0};
+	std::atomic<uint64_t> bytesWritten{0};
+	LatencyHistogram readLatency;
+
+	void addRead(uint64_t bytes, std::chrono::steady_clock::time_point start) {
+		uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		numReads.fetch_add(1, std::memory_order_relaxed);
+		bytesRead.fetch_add(bytes, std::memory_order_relaxed);
+		readMicros.fetch_add(micros, std::memory_order_relaxed);
+		readLatency.add(micros);
+	}
+
+	void reset() {
+		numReads = 0;
+		bytesRead = 0;
+		readMicros = 0;
+		bytesWritten = 0;
+		readLatency.reset();
+	}
+};
+
+class AccountedRandomAccessFile : public rocksdb::FSRandomAccessFileOwnerWrapper {
+public:
+	AccountedRandomAccessFile(std::unique_ptr<rocksdb::FSRandomAccessFile>&& file, std::shared_ptr<FileIoStats> stats)
+		: rocksdb::FSRandomAccessFileOwnerWrapper(std::move(file)), stats_(std::move(stats)) {}
+
+	rocksdb::IOStatus Read(uint64_t offset, size_t n, const rocksdb::IOOptions& options, rocksdb::Slice* result,
+			char* scratch, rocksdb::IODebugContext* dbg) const override {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		rocksdb::IOStatus s = target()->Read(offset, n, options, result, scratch, dbg);
+		stats_->addRead(result->size(), start);
+		return s;
+	}
+
+	// the requests run in one call, each is counted with the latency of the whole batch
+	rocksdb::IOStatus MultiRead(rocksdb::FSReadRequest* reqs, size_t num_reqs, const rocksdb::IOOptions& options,
+			rocksdb::IODebugContext* dbg) override {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		rocksdb::IOStatus s = target()->MultiRead(reqs, num_reqs, options, dbg);
+		for (size_t i = 0; i < num_reqs; i++) {stats_->addRead(reqs[i].result.size(), start);}
+		return s;
+	}
+
+private:
+	std::shared_ptr<FileIoStats> stats_;
+};
+
+class AccountedSequentialFile : public rocksdb::FSSequentialFileOwnerWrapper {
+public:
+	AccountedSequentialFile(std::unique_ptr<rocksdb::FSSequentialFile>&& file, std::shared_ptr<FileIoStats> stats)
+		: rocksdb::FSSequentialFileOwnerWrapper(std::move(file)), stats_(std::move(stats)) {}
+
+	rocksdb::IOStatus Read(size_t n, const rocksdb::IOOptions& options, rocksdb::Slice* result, char* scratch,
+			rocksdb::IODebugContext* dbg) override {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		rocksdb::IOStatus s = target()->Read(n, options, result, scratch, dbg);
+		stats_->addRead(result->size(), start);
+		return s;
+	}
+
+	rocksdb::IOStatus PositionedRead(uint64_t offset, size_t n, const rocksdb::IOOptions& options,
+			rocksdb::Slice* result, char* scratch, rocksdb::IODebugContext* dbg) override {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		rocksdb::IOStatus s = target()->PositionedRead(offset, n, options, result, scratch, dbg);
+		stats_->addRead(result->size(), start);
+		return s;
+	}
+
+private:
+	std::shared_ptr<FileIoStats> stats_;
+};
+
+class AccountedWritableFile : public rocksdb::FSWritableFileOwnerWrapper {
+public:
+	AccountedWritableFile(std::unique_ptr<rocksdb::FSWritableFile>&& file, std::shared_ptr<FileIoStats> stats)
+		: rocksdb::FSWritableFileOwnerWrapper(std::move(file)), stats_(std::move(stats)) {}
+
+	rocksdb::IOStatus Append(const rocksdb::Slice& data, const rocksdb::IOOptions& options,
+			rocksdb::IODebugContext* dbg) override {
+		stats_->bytesWritten.fetch_add(data.size(), std::memory_order_relaxed);
+		return target()->Append(data, options, dbg);
+	}
+
+	rocksdb::IOStatus Append(const rocksdb::Slice& data, const rocksdb::IOOptions& options,
+			const rocksdb::DataVerificationInfo& verification_info, rocksdb::IODebugContext* dbg) override {
+		stats_->bytesWritten.fetch_add(data.size(), std::memory_order_relaxed);
+		return target()->Append(data, options, verification_info, dbg);
+	}
+
+	rocksdb::IOStatus PositionedAppend(const rocksdb::Slice& data, uint64_t offset, const rocksdb::IOOptions& options,
+			rocksdb::IODebugContext* dbg) override {
+		stats_->bytesWritten.fetch_add(data.size(), std::memory_order_relaxed);
+		return target()->PositionedAppend(data, offset, options, dbg);
+	}
+
+private:
+	std::shared_ptr<FileIoStats> stats_;
+};
+
+class IoAccountingFileSystem : public rocksdb::FileSystemWrapper {
+public:
+	explicit IoAccountingFileSystem(const std::shared_ptr<rocksdb::FileSystem>& target)
+		: rocksdb::FileSystemWrapper(target) {}
+
+	const char* Name() const override {return "IoAccountingFileSystem";}
+
+	rocksdb::IOStatus NewRandomAccessFile(const std::string& fname, const rocksdb::FileOptions& file_opts,
+			std::unique_ptr<rocksdb::FSRandomAccessFile>* result, rocksdb::IODebugContext* dbg) override {
+		rocksdb::IOStatus s = target()->NewRandomAccessFile(fname, file_opts, result, dbg);
+		if (s.ok()) {result->reset(new AccountedRandomAccessFile(std::move(*result), statsOf(fname)));}
+		return s;
+	}
+
+	rocksdb::IOStatus NewSequentialFile(const std::string& fname, const rocksdb::FileOptions& file_opts,
+			std::unique_ptr<rocksdb::FSSequentialFile>* result, rocksdb::IODebugContext* dbg) override {
+		rocksdb::IOStatus s = target()->NewSequentialFile(fname, file_opts, result, dbg);
+		if (s.ok()) {result->reset(new AccountedSequentialFile(std::move(*result), statsOf(fname)));}
+		return s;
+	}
+
+	rocksdb::IOStatus NewWritableFile(const std::string& fname, const rocksdb::FileOptions& file_opts,
+			std::unique_ptr<rocksdb::FSWritableFile>* result, rocksdb::IODebugContext* dbg) override {
+		rocksdb::IOStatus s = target()->NewWritableFile(fname, file_opts, result, dbg);
+		if (s.ok()) {result->reset(new AccountedWritableFile(std::move(*result), statsOf(fname)));}
+		return s;
+	}
+
+	// start a phase
+	void reset() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (auto& entry : files_) {entry.second->reset();}
+	}
+
+	// the I/O since the last reset, by file type and SST level
+	void print(rocksdb::DB* db, const std::string& phase) {
+		std::map<std::string, int> levelOf;  // file name -> level of the live SST files
+		std::vector<rocksdb::LiveFileMetaData> liveFiles;
+		db->GetLiveFilesMetaData(&liveFiles);
+		for (const rocksdb::LiveFileMetaData& file : liveFiles) {levelOf[baseName(file.name)] = file.level;}
+		std::map<std::string, Totals> byType;
+		std::map<std::string, Totals> byLevel;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (auto& entry : files_) {
+				std::string name = baseName(entry.first);
+				std::string type = fileType(name);
+				byType[type].add(*entry.second);
+				if (type == "SST") {
+					auto level = levelOf.find(name);
+					byLevel[level != levelOf.end() ? "L" + std::to_string(level->second) : "deleted"].add(*entry.second);
+				}
+			}
+		}
+		printf("File system I/O %s:\n", phase.c_str());
+		for (auto& entry : byType) {entry.second.print(entry.first);}
+		for (auto& entry : byLevel) {entry.second.print("SST " + entry.first);}
+	}
+
+private:
+	struct Totals {
+		uint64_t numReads = 0;
+		uint64_t bytesRead = 0;
+		uint64_t readMicros = 0;
+		uint64_t bytesWritten = 0;
+		std::vector<uint64_t> latency;
+
+		void add(const FileIoStats& stats) {
+			numReads += stats.numReads;
+			bytesRead += stats.bytesRead;
+			readMicros += stats.readMicros;
+			bytesWritten += stats.bytesWritten;
+			stats.readLatency.addTo(&latency);
+		}
+
+		void print(const std::string& name) const {
+			if (numReads == 0 && bytesWritten == 0) {return;}
+			printf("  %s: %llu reads, %llu bytes read, avg %.1fus, p50 <%lluus, p99 <%lluus, %llu bytes written\n",
+				name.c_str(), (unsigned long long)numReads, (unsigned long long)bytesRead,
+				numReads > 0 ? (double)readMicros / numReads : 0.0,
+				(unsigned long long)LatencyHistogram::percentile(latency, 0.5),
+				(unsigned long long)LatencyHistogram::percentile(latency, 0.99), (unsigned long long)bytesWritten);
+		}
+	};
+
+	static std::string baseName(const std::string& path) {
+		size_t slash = path.find_last_of('/');
+		return slash == std::string::npos ? path : path.substr(slash + 1);
+	}
+
+	static std::string fileType(const std::string& name) {
+		auto endsWith = [&name](const std::string& suffix) {
+			return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+		};
+		if (endsWith(".sst")) {return "SST";}
+		if (endsWith(".log")) {return "WAL";}
+		if (endsWith(".blob")) {return "blob";}
+		if (name.compare(0, 9, "MANIFEST-") == 0) {return "MANIFEST";}
+		return "other";
+	}
+
+	// a file reopened under the same name keeps adding to the same counters
+	std::shared_ptr<FileIoStats> statsOf(const std::string& fname) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::shared_ptr<FileIoStats>& stats = files_[fname];
+		if (stats == nullptr) {stats = std::make_shared<FileIoStats>();}
+		return stats;
+	}
+
+	std::mutex mutex_;  // guards files_
+	std::map<std::string, std::shared_ptr<FileIoStats>> files_;
+};
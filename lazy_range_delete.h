@@ -0,0 +1,269 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "rocksdb/compaction_filter.h"
+#include "rocksdb/db.h"
+#include "rocksdb/iterator.h"
+#include "rocksdb/utilities/stackable_db.h"
+#include "rocksdb/write_batch.h"
+
+// Lazy range deletion: deleted intervals live in memory instead of becoming range tombstones.
+// Reads check the interval set first, and a compaction filter drops the covered keys when
+// compaction rewrites them. Nothing is written to the LSM for a delete, so reads never pay
+// for range tombstones. The set is not persisted: deleted data comes back after a restart
+// unless a compaction has already reclaimed it.
+
+// disjoint deleted intervals [start, end), sorted by start key
+class DeletedRangeSet {
+public:
+	// add [start, end), merging it with overlapping or adjacent intervals
+	void add(const std::string& start, const std::string& end) {
+		if (start >= end) {return;}
+		std::unique_lock<std::shared_mutex> lock(mutex_);
+		std::string newStart = start;
+		std::string newEnd = end;
+		auto it = ranges_.upper_bound(start);
+		if (it != ranges_.begin() && std::prev(it)->second >= start) {--it;}
+		while (it != ranges_.end() && it->first <= newEnd) {
+			if (it->first < newStart) {newStart = it->first;}
+			if (it->second > newEnd) {newEnd = it->second;}
+			it = ranges_.erase(it);
+		}
+		ranges_[newStart] = newEnd;
+	}
+
+	// whether the key lies in a deleted interval
+	bool covers(const rocksdb::Slice& key) const {
+		std::shared_lock<std::shared_mutex> lock(mutex_);
+		return findCovering(key) != ranges_.end();
+	}
+
+	// get the deleted interval containing the key, return false if there is none
+	bool coveringRange(const rocksdb::Slice& key, std::string* start, std::string* end) const {
+		std::shared_lock<std::shared_mutex> lock(mutex_);
+		auto it = findCovering(key);
+		if (it == ranges_.end()) {return false;}
+		*start = it->first;
+		*end = it->second;
+		return true;
+	}
+
+	// a re-inserted key is no longer deleted, split its interval around it
+	void erase(const rocksdb::Slice& key) {
+		std::unique_lock<std::shared_mutex> lock(mutex_);
+		auto it = findCovering(key);
+		if (it == ranges_.end()) {return;}
+		std::string start = it->first;
+		std::string end = it->second;
+		std::string keyStr = key.ToString();
+		ranges_.erase(it);
+		if (start < keyStr) {ranges_[start] = keyStr;}
+		// the smallest key greater than keyStr in bytewise order
+		std::string successor = keyStr + '\0';
+		if (successor < end) {ranges_[successor] = end;}
+	}
+
+	size_t size() const {
+		std::shared_lock<std::shared_mutex> lock(mutex_);
+		return ranges_.size();
+	}
+
+	std::vector<std::pair<std::string, std::string>> ranges() const {
+		std::shared_lock<std::shared_mutex> lock(mutex_);
+		return std::vector<std::pair<std::string, std::string>>(ranges_.begin(), ranges_.end());
+	}
+
+private:
+	// caller must hold the mutex
+	// the transparent comparator lets the lookup use the slice without copying it into a string
+	std::map<std::string, std::string, std::less<>>::const_iterator findCovering(const rocksdb::Slice& key) const {
+		std::string_view keyView(key.data(), key.size());
+		auto it = ranges_.upper_bound(keyView);
+		if (it == ranges_.begin()) {return ranges_.end();}
+		--it;
+		return keyView < it->second ? it : ranges_.end();
+	}
+
+	mutable std::shared_mutex mutex_;
+	std::map<std::string, std::string, std::less<>> ranges_;
+};
+
+// drop every key covered by the deleted intervals during compaction
+// outside the bottommost level RocksDB turns a dropped key into a point deletion,
+// so compact down to the bottommost level to reclaim the space completely
+class LazyRangeDeleteFilter : public rocksdb::CompactionFilter {
+public:
+	explicit LazyRangeDeleteFilter(std::shared_ptr<DeletedRangeSet> ranges) : ranges_(std::move(ranges)) {}
+
+	bool Filter(int /*level*/, const rocksdb::Slice& key, const rocksdb::Slice& /*existing_value*/,
+			std::string* /*new_value*/, bool* /*value_changed*/) const override {
+		return ranges_->covers(key);
+	}
+
+	// the key decides, so values kept in blob files are not read back for the filter
+	Decision FilterBlobByKey(int /*level*/, const rocksdb::Slice& key, std::string* /*new_value*/,
+			std::string* /*skip_until*/) const override {
+		return ranges_->covers(key) ? Decision::kRemove : Decision::kKeep;
+	}
+
+	const char* Name() const override {return "LazyRangeDeleteFilter";}
+
+private:
+	std::shared_ptr<DeletedRangeSet> ranges_;
+};
+
+class LazyRangeDeleteFilterFactory : public rocksdb::CompactionFilterFactory {
+public:
+	explicit LazyRangeDeleteFilterFactory(std::shared_ptr<DeletedRangeSet> ranges) : ranges_(std::move(ranges)) {}
+
+	std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
+			const rocksdb::CompactionFilter::Context& /*context*/) override {
+		return std::unique_ptr<rocksdb::CompactionFilter>(new LazyRangeDeleteFilter(ranges_));
+	}
+
+	const char* Name() const override {return "LazyRangeDeleteFilterFactory";}
+
+private:
+	std::shared_ptr<DeletedRangeSet> ranges_;
+};
+
+// iterator skipping the keys covered by the deleted intervals
+class LazyRangeDeleteIterator : public rocksdb::Iterator {
+public:
+	LazyRangeDeleteIterator(rocksdb::Iterator* iter, std::shared_ptr<DeletedRangeSet> ranges)
+		: iter_(iter), ranges_(std::move(ranges)) {}
+
+	bool Valid() const override {return iter_->Valid();}
+	void SeekToFirst() override {iter_->SeekToFirst(); skipForward();}
+	void SeekToLast() override {iter_->SeekToLast(); skipBackward();}
+	void Seek(const rocksdb::Slice& target) override {iter_->Seek(target); skipForward();}
+	void SeekForPrev(const rocksdb::Slice& target) override {iter_->SeekForPrev(target); skipBackward();}
+	void Next() override {iter_->Next(); skipForward();}
+	void Prev() override {iter_->Prev(); skipBackward();}
+	rocksdb::Slice key() const override {return iter_->key();}
+	rocksdb::Slice value() const override {return iter_->value();}
+	rocksdb::Status status() const override {return iter_->status();}
+
+private:
+	// jump over a whole deleted interval with one seek instead of stepping through it
+	void skipForward() {
+		std::string start;
+		std::string end;
+		while (iter_->Valid() && ranges_->coveringRange(iter_->key(), &start, &end)) {
+			iter_->Seek(end);
+		}
+	}
+
+	void skipBackward() {
+		std::string start;
+		std::string end;
+		while (iter_->Valid() && ranges_->coveringRange(iter_->key(), &start, &end)) {
+			iter_->SeekForPrev(start);
+			if (iter_->Valid() && iter_->key() == start) {iter_->Prev();}
+		}
+	}
+
+	std::unique_ptr<rocksdb::Iterator> iter_;
+	std::shared_ptr<DeletedRangeSet> ranges_;
+};
+
+// DB wrapper turning DeleteRange on the default column family into a lazy range delete
+// install LazyRangeDeleteFilterFactory on the same set before opening the DB
+class LazyRangeDeleteDB : public rocksdb::StackableDB {
+public:
+	LazyRangeDeleteDB(rocksdb::DB* db, std::shared_ptr<DeletedRangeSet> ranges)
+		: rocksdb::StackableDB(db), ranges_(std::move(ranges)) {}
+
+	using rocksdb::StackableDB::Get;
+	using rocksdb::StackableDB::NewIterator;
+	using rocksdb::StackableDB::Put;
+	using rocksdb::StackableDB::Merge;
+	using rocksdb::StackableDB::DeleteRange;
+
+	rocksdb::Status Get(const rocksdb::ReadOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+			const rocksdb::Slice& key, rocksdb::PinnableSlice* value) override {
+		if (isDefault(column_family) && ranges_->covers(key)) {return rocksdb::Status::NotFound();}
+		return rocksdb::StackableDB::Get(options, column_family, key, value);
+	}
+
+	rocksdb::Iterator* NewIterator(const rocksdb::ReadOptions& options,
+			rocksdb::ColumnFamilyHandle* column_family) override {
+		rocksdb::Iterator* iter = rocksdb::StackableDB::NewIterator(options, column_family);
+		if (!isDefault(column_family)) {return iter;}
+		return new LazyRangeDeleteIterator(iter, ranges_);
+	}
+
+	// the key leaves the deleted set before it is written, so the filter never drops the new value
+	rocksdb::Status Put(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+			const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+		if (isDefault(column_family)) {ranges_->erase(key);}
+		return rocksdb::StackableDB::Put(options, column_family, key, value);
+	}
+
+	rocksdb::Status Merge(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+			const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+		if (isDefault(column_family)) {ranges_->erase(key);}
+		return rocksdb::StackableDB::Merge(options, column_family, key, value);
+	}
+
+	// range deletes inside a write batch still write a tombstone, only the batch's puts are tracked
+	rocksdb::Status Write(const rocksdb::WriteOptions& options, rocksdb::WriteBatch* updates) override {
+		ReinsertHandler handler(ranges_.get());
+		rocksdb::Status s = updates->Iterate(&handler);
+		if (!s.ok()) {return s;}
+		return rocksdb::StackableDB::Write(options, updates);
+	}
+
+	rocksdb::Status DeleteRange(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+			const rocksdb::Slice& begin_key, const rocksdb::Slice& end_key) override {
+		if (!isDefault(column_family)) {
+			return rocksdb::StackableDB::DeleteRange(options, column_family, begin_key, end_key);
+		}
+		ranges_->add(begin_key.ToString(), end_key.ToString());
+		return rocksdb::Status::OK();
+	}
+
+private:
+	class ReinsertHandler : public rocksdb::WriteBatch::Handler {
+	public:
+		explicit ReinsertHandler(DeletedRangeSet* ranges) : ranges_(ranges) {}
+		rocksdb::Status PutCF(uint32_t column_family_id, const rocksdb::Slice& key,
+				const rocksdb::Slice& /*value*/) override {
+			if (column_family_id == 0) {ranges_->erase(key);}
+			return rocksdb::Status::OK();
+		}
+		rocksdb::Status MergeCF(uint32_t column_family_id, const rocksdb::Slice& key,
+				const rocksdb::Slice& /*value*/) override {
+			if (column_family_id == 0) {ranges_->erase(key);}
+			return rocksdb::Status::OK();
+		}
+		// the default handler rejects these, but they do not affect the deleted set
+		rocksdb::Status DeleteCF(uint32_t /*column_family_id*/, const rocksdb::Slice& /*key*/) override {
+			return rocksdb::Status::OK();
+		}
+		rocksdb::Status SingleDeleteCF(uint32_t /*column_family_id*/, const rocksdb::Slice& /*key*/) override {
+			return rocksdb::Status::OK();
+		}
+		rocksdb::Status DeleteRangeCF(uint32_t /*column_family_id*/, const rocksdb::Slice& /*begin_key*/,
+				const rocksdb::Slice& /*end_key*/) override {
+			return rocksdb::Status::OK();
+		}
+	private:
+		DeletedRangeSet* ranges_;
+	};
+
+	bool isDefault(rocksdb::ColumnFamilyHandle* column_family) const {
+		return column_family == nullptr || column_family->GetID() == 0;
+	}
+
+	std::shared_ptr<DeletedRangeSet> ranges_;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/metadata.h"
+#include "rocksdb/options.h"
+#include "rocksdb/table_properties.h"
+
+// Deterministic LSM shapes: put the base data and the range tombstones at chosen levels,
+// so tombstone read cost can be measured per level instead of only "memtable" or "one L0 file".
+// Data is flushed into a fixed number of L0 files and moved down with CompactFiles; the flushed
+// tombstone file is moved to its own level the same way. Ingestion is not used for placement
+// because an ingested file always lands on the lowest level it fits, never on a chosen one.
+// The default column family is shaped; a level below 0 keeps the driver's own layout.
+
+class LsmShapeBuilder {
+public:
+	LsmShapeBuilder(int dataLevel, int dataL0Files, int tombstoneLevel)
+		: dataLevel_(dataLevel), dataL0Files_(dataL0Files), tombstoneLevel_(tombstoneLevel) {}
+
+	bool isDataPlaced() const {return dataLevel_ >= 0;}
+	bool isTombstonePlaced() const {return tombstoneLevel_ >= 0;}
+
+	// tombstones must stay above the data they cover: moving them down next to L0 data files, or to
+	// a level at or below the data, merges them into it, and at the bottommost level drops them
+	// only the default column family is shaped, so a partitioned DB cannot be, and files are moved
+	// between levels, so only leveled compaction ("" or "level") keeps the shape
+	rocksdb::Status validate(int numLevels, bool isPartitioned, const std::string& compactionStyle) const {
+		if (isPartitioned && (isDataPlaced() || isTombstonePlaced())) {
+			return rocksdb::Status::NotSupported("LSM shapes cannot be combined with column family partitions");
+		}
+		if (!compactionStyle.empty() && compactionStyle != "level" && (isDataPlaced() || isTombstonePlaced())) {
+			return rocksdb::Status::NotSupported("LSM shapes need compaction_style=level or empty");
+		}
+		if (dataLevel_ >= numLevels || tombstoneLevel_ >= numLevels) {
+			return rocksdb::Status::InvalidArgument("level out of range");
+		}
+		if (dataL0Files_ < 1) {return rocksdb::Status::InvalidArgument("data_l0_files must be at least 1");}
+		if (tombstoneLevel_ > 0 && dataLevel_ <= tombstoneLevel_) {
+			return rocksdb::Status::InvalidArgument("a tombstone level below L0 needs data_level below it");
+		}
+		return rocksdb::Status::OK();
+	}
+
+	// number of keys to load between flushes so the data ends up in exactly dataL0Files L0 files, 0 if not shaped
+	// the memtable is resized to hold one file, so no automatic flush splits them further
+	int prepareLoad(rocksdb::DB* db, int numKeys, int entrySize) {
+		if (dataLevel_ != 0) {return 0;}
+		int keysPerFile = (numKeys + dataL0Files_ - 1) / dataL0Files_;
+		// leave room for the memtable's own per-entry overhead
+		uint64_t bufferSize = (uint64_t)keysPerFile * (entrySize + 64) * 5 / 4;
+		rocksdb::Status s = db->SetOptions({{"write_buffer_size", std::to_string(bufferSize)}});
+		if (!s.ok()) {std::cout << "Failed to resize the memtable: " << s.ToString() << std::endl;}
+		return keysPerFile;
+	}
+
+	// move the flushed data from L0 to its level
+	rocksdb::Status placeData(rocksdb::DB* db) {
+		if (dataLevel_ <= 0) {return rocksdb::Status::OK();}
+		return moveFiles(db, filesAt(db, 0), dataLevel_);
+	}
+
+	// call before flushing the tombstones, so their file can be told apart from the data files
+	void rememberFiles(rocksdb::DB* db) {
+		knownFiles_ = filesAt(db, 0);
+	}
+
+	// move the newly flushed tombstone file from L0 to its level
+	rocksdb::Status placeTombstones(rocksdb::DB* db) {
+		if (tombstoneLevel_ <= 0) {return rocksdb::Status::OK();}
+		std::vector<std::string> newFiles;
+		for (const std::string& file : filesAt(db, 0)) {
+			if (knownFiles_.count(file) == 0) {newFiles.push_back(file);}
+		}
+		return moveFiles(db, std::set<std::string>(newFiles.begin(), newFiles.end()), tombstoneLevel_);
+	}
+
+private:
+	static std::set<std::string> filesAt(rocksdb::DB* db, int level) {
+		rocksdb::ColumnFamilyMetaData meta;
+		db->GetColumnFamilyMetaData(&meta);
+		std::set<std::string> files;
+		for (const rocksdb::SstFileMetaData& file : meta.levels[level].files) {
+			files.insert(file.db_path + file.name);
+		}
+		return files;
+	}
+
+	static rocksdb::Status moveFiles(rocksdb::DB* db, const std::set<std::string>& files, int level) {
+		if (files.empty()) {return rocksdb::Status::OK();}
+		rocksdb::CompactionOptions compactOptions;
+		return db->CompactFiles(compactOptions, std::vector<std::string>(files.begin(), files.end()), level);
+	}
+
+	int dataLevel_;
+	int dataL0Files_;
+	int tombstoneLevel_;
+	std::set<std::string> knownFiles_;
+};
+
+// print files, bytes, entries and range tombstones per level
+inline void printLsmShape(rocksdb::DB* db, const std::string& info) {
+	rocksdb::ColumnFamilyMetaData meta;
+	db->GetColumnFamilyMetaData(&meta);
+	// table properties are keyed by the full file path
+	rocksdb::TablePropertiesCollection props;
+	db->GetPropertiesOfAllTables(&props);
+	std::cout << "LSM shape " << info << ":" << std::endl;
+	for (const rocksdb::LevelMetaData& level : meta.levels) {
+		if (level.files.empty()) {continue;}
+		uint64_t numEntries = 0;
+		uint64_t numRangeDels = 0;
+		for (const rocksdb::SstFileMetaData& file : level.files) {
+			auto it = props.find(file.db_path + file.name);
+			if (it == props.end()) {continue;}
+			numEntries += it->second->num_entries;
+			numRangeDels += it->second->num_range_deletions;
+		}
+		std::cout << "  L" << level.level << ": " << level.files.size() << " files, " << level.size << " bytes, "
+			<< numEntries << " entries, " << numRangeDels << " range tombstones" << std::endl;
+	}
+}
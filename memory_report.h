@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "rocksdb/cache.h"
+#include "rocksdb/db.h"
+#include "rocksdb/table_properties.h"
+#include "rocksdb/utilities/memory_util.h"
+
+// Memory footprint per phase: memtables, block cache usage and pinned usage, table readers,
+// MemoryUtil's usage by type and the process RSS, each with its change since the previous report.
+// Range tombstones held in the memtable show up as memtable growth after the deletes (NF). Once
+// flushed (WF) they live in the SST range-del blocks; estimate-table-readers-mem covers the index,
+// filter and properties but not the fragmented tombstones a table reader keeps, so no byte count
+// here is their cost, and the number of range tombstones in SST files is printed instead.
+
+// resident set size of the process in bytes, 0 where /proc is not available
+inline uint64_t processRssBytes() {
+#if defined(__linux__)
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (file == nullptr) {return 0;}
+	unsigned long long totalPages = 0;
+	unsigned long long residentPages = 0;
+	int numRead = fscanf(file, "%llu %llu", &totalPages, &residentPages);
+	fclose(file);
+	if (numRead != 2) {return 0;}
+	return (uint64_t)residentPages * (uint64_t)sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
+class MemoryReport {
+public:
+	// blockCache may be null when the table uses RocksDB's own default cache or no cache at all
+	MemoryReport(bool isEnabled, std::shared_ptr<rocksdb::Cache> blockCache)
+		: isEnabled_(isEnabled), blockCache_(std::move(blockCache)) {}
+
+	void print(rocksdb::DB* db, const std::string& info) {
+		if (!isEnabled_) {return;}
+		Footprint current = measure(db);
+		printf("Memory %s:\n", info.c_str());
+		for (size_t i = 0; i < current.values.size(); i++) {
+			long long delta = hasPrevious_ ? (long long)current.values[i] - (long long)previous_.values[i] : 0;
+			printf("  %-28s %llu bytes (%+lld)\n", kFieldNames[i], (unsigned long long)current.values[i], delta);
+		}
+		printf("  %-28s %llu\n", "SST range tombstones", (unsigned long long)current.sstRangeDels);
+		previous_ = current;
+		hasPrevious_ = true;
+	}
+
+private:
+	static constexpr const char* kFieldNames[] = {
+		"memtables (cur size)", "memtables (incl. pinned)", "block cache usage", "block cache pinned",
+		"table readers", "MemoryUtil memtable total", "MemoryUtil memtable unflushed",
+		"MemoryUtil table readers", "MemoryUtil cache total", "process RSS"};
+
+	struct Footprint {
+		std::vector<uint64_t> values;
+		uint64_t sstRangeDels = 0;
+	};
+
+	Footprint measure(rocksdb::DB* db) const {
+		uint64_t curMemtables = 0;
+		uint64_t allMemtables = 0;
+		uint64_t cacheUsage = 0;
+		uint64_t cachePinned = 0;
+		uint64_t tableReaders = 0;
+		// memtables and table readers are summed over the column families of a partitioned DB
+		db->GetAggregatedIntProperty(rocksdb::DB::Properties::kCurSizeAllMemTables, &curMemtables);
+		db->GetAggregatedIntProperty(rocksdb::DB::Properties::kSizeAllMemTables, &allMemtables);
+		db->GetAggregatedIntProperty(rocksdb::DB::Properties::kEstimateTableReadersMem, &tableReaders);
+		// the block cache is shared, so it is read once
+		db->GetIntProperty(rocksdb::DB::Properties::kBlockCacheUsage, &cacheUsage);
+		db->GetIntProperty(rocksdb::DB::Properties::kBlockCachePinnedUsage, &cachePinned);
+		std::map<rocksdb::MemoryUtil::UsageType, uint64_t> usageByType;
+		std::unordered_set<const rocksdb::Cache*> caches;
+		if (blockCache_ != nullptr) {caches.insert(blockCache_.get());}
+		rocksdb::MemoryUtil::GetApproximateMemoryUsageByType({db}, caches, &usageByType);
+		Footprint footprint;
+		footprint.values = {curMemtables, allMemtables, cacheUsage, cachePinned, tableReaders,
+			usageByType[rocksdb::MemoryUtil::kMemTableTotal], usageByType[rocksdb::MemoryUtil::kMemTableUnFlushed],
+			usageByType[rocksdb::MemoryUtil::kTableReadersTotal], usageByType[rocksdb::MemoryUtil::kCacheTotal],
+			processRssBytes()};
+		rocksdb::TablePropertiesCollection props;
+		db->GetPropertiesOfAllTables(&props);
+		for (const auto& entry : props) {footprint.sstRangeDels += entry.second->num_range_deletions;}
+		return footprint;
+	}
+
+	bool isEnabled_;
+	std::shared_ptr<rocksdb::Cache> blockCache_;
+	bool hasPrevious_ = false;
+	Footprint previous_;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "rocksdb/db.h"
+#include "rocksdb/memtablerep.h"
+#include "rocksdb/options.h"
+
+// Memtable sweep: the representation and size of the memtables, which hold the tombstones and
+// part of the data in the NF drivers. "skiplist" is the default; "vector" appends and sorts only
+// when read, suiting the sequential bulk load; "hash_skiplist" buckets the keys by prefix, so it
+// needs a prefix extractor. Neither of the last two takes concurrent writes.
+inline rocksdb::Status configureMemtable(rocksdb::Options* options, const std::string& memtable, bool hasPrefixExtractor,
+		int writeBufferSizeMb, int maxWriteBufferNumber, double prefixBloomSizeRatio) {
+	if (memtable == "skiplist") {
+		options->memtable_factory.reset(new rocksdb::SkipListFactory);
+	}
+	else if (memtable == "vector") {
+		options->memtable_factory.reset(new rocksdb::VectorRepFactory);
+		options->allow_concurrent_memtable_write = false;
+	}
+	else if (memtable == "hash_skiplist") {
+		if (!hasPrefixExtractor) {return rocksdb::Status::InvalidArgument("hash_skiplist needs prefix_len");}
+		options->memtable_factory.reset(rocksdb::NewHashSkipListRepFactory());
+		options->allow_concurrent_memtable_write = false;
+	}
+	else if (!memtable.empty()) {
+		return rocksdb::Status::InvalidArgument("unknown memtable: " + memtable);
+	}
+	if (writeBufferSizeMb > 0) {options->write_buffer_size = (size_t)writeBufferSizeMb << 20;}
+	if (maxWriteBufferNumber > 0) {options->max_write_buffer_number = maxWriteBufferNumber;}
+	if (prefixBloomSizeRatio > 0.0) {
+		// whole keys as well, since the point reads look up whole keys
+		options->memtable_prefix_bloom_size_ratio = prefixBloomSizeRatio;
+		options->memtable_whole_key_filtering = true;
+	}
+	return rocksdb::Status::OK();
+}
+
+// memtable memory and entries, with the point deletes of the active memtable
+// RocksDB does not count range tombstones held in the memtable, their cost shows in the memtable bytes
+inline void printMemtableState(rocksdb::DB* db, const std::string& info) {
+	uint64_t memtableSize = 0;
+	uint64_t activeEntries = 0;
+	uint64_t immutableMemtables = 0;
+	uint64_t activeDeletes = 0;
+	db->GetIntProperty(rocksdb::DB::Properties::kCurSizeAllMemTables, &memtableSize);
+	db->GetIntProperty(rocksdb::DB::Properties::kNumEntriesActiveMemTable, &activeEntries);
+	db->GetIntProperty(rocksdb::DB::Properties::kNumImmutableMemTable, &immutableMemtables);
+	db->GetIntProperty(rocksdb::DB::Properties::kNumDeletesActiveMemTable, &activeDeletes);
+	std::cout << "Memtables " << info << ": " << memtableSize << " bytes, " << activeEntries << " entries and "
+		<< activeDeletes << " point deletes in the active memtable, " << immutableMemtables << " immutable memtables" << std::endl;
+}
@@ -0,0 +1,417 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/iterator.h"
+#include "rocksdb/metadata.h"
+#include "rocksdb/options.h"
+#include "rocksdb/table_properties.h"
+#include "rocksdb/utilities/stackable_db.h"
+#include "rocksdb/write_batch.h"
+
+// Column-family-per-partition layout: the key space is cut at fixed boundaries and every
+// partition lives in its own column family. A DeleteRange that covers whole partitions drops
+// their column families, which is O(1) and leaves no tombstone behind; partial overlaps still
+// use DeleteRange inside the partition. Reads and writes on the default column family are routed
+// to the partition owning the key, and the metadata and table properties of the default column
+// family are those of all partitions. Dropping partitions is not safe against concurrent readers.
+
+// iterator over the partitions in key order
+// partitions hold disjoint key ranges, so their iterators are concatenated instead of merged
+class PartitionIterator : public rocksdb::Iterator {
+public:
+	// iters[i] belongs to partition i, nullptr for a dropped partition
+	PartitionIterator(std::vector<rocksdb::Iterator*> iters, std::vector<std::string> boundaries)
+		: boundaries_(std::move(boundaries)), current_(iters.size()) {
+		for (rocksdb::Iterator* iter : iters) {iters_.emplace_back(iter);}
+	}
+
+	bool Valid() const override {return current_ < iters_.size() && iters_[current_]->Valid();}
+
+	void SeekToFirst() override {moveForward(0, nullptr);}
+	void SeekToLast() override {moveBackward(iters_.size() - 1, nullptr);}
+	void Seek(const rocksdb::Slice& target) override {moveForward(partitionOf(target), &target);}
+	void SeekForPrev(const rocksdb::Slice& target) override {moveBackward(partitionOf(target), &target);}
+
+	void Next() override {
+		iters_[current_]->Next();
+		if (!iters_[current_]->Valid()) {moveForward(current_ + 1, nullptr);}
+	}
+
+	void Prev() override {
+		iters_[current_]->Prev();
+		if (!iters_[current_]->Valid()) {moveBackward(current_ - 1, nullptr);}
+	}
+
+	rocksdb::Slice key() const override {return iters_[current_]->key();}
+	rocksdb::Slice value() const override {return iters_[current_]->value();}
+
+	rocksdb::Status status() const override {
+		for (auto& iter : iters_) {
+			if (iter != nullptr && !iter->status().ok()) {return iter->status();}
+		}
+		return rocksdb::Status::OK();
+	}
+
+private:
+	size_t partitionOf(const rocksdb::Slice& key) const {
+		return std::upper_bound(boundaries_.begin(), boundaries_.end(), key.ToString()) - boundaries_.begin();
+	}
+
+	// position at the first key >= target from partition p on, or at the first key of p if target is null
+	void moveForward(size_t p, const rocksdb::Slice* target) {
+		for (current_ = p; current_ < iters_.size(); current_++) {
+			if (iters_[current_] == nullptr) {continue;}
+			if (target != nullptr && current_ == p) {iters_[current_]->Seek(*target);}
+			else {iters_[current_]->SeekToFirst();}
+			if (iters_[current_]->Valid()) {return;}
+		}
+	}
+
+	// position at the last key <= target from partition p down, size_t wraps around below 0
+	void moveBackward(size_t p, const rocksdb::Slice* target) {
+		for (current_ = p; current_ < iters_.size(); current_--) {
+			if (iters_[current_] == nullptr) {continue;}
+			if (target != nullptr && current_ == p) {iters_[current_]->SeekForPrev(*target);}
+			else {iters_[current_]->SeekToLast();}
+			if (iters_[current_]->Valid()) {return;}
+		}
+		current_ = iters_.size();
+	}
+
+	std::vector<std::unique_ptr<rocksdb::Iterator>> iters_;
+	std::vector<std::string> boundaries_;
+	size_t current_;
+};
+
+class PartitionedDB : public rocksdb::StackableDB {
+public:
+	// create one column family per partition, boundaries must be sorted
+	// n boundaries make n + 1 partitions, partition i holds [boundaries[i - 1], boundaries[i])
+	// on failure the wrapped DB is closed as well
+	static rocksdb::Status Open(rocksdb::DB* db, const rocksdb::ColumnFamilyOptions& cfOptions,
+			const std::vector<std::string>& boundaries, PartitionedDB** result) {
+		PartitionedDB* partitioned = new PartitionedDB(db, cfOptions, boundaries);
+		rocksdb::Status s;
+		for (size_t i = 0; i <= boundaries.size() && s.ok(); i++) {
+			s = partitioned->createPartition(i);
+		}
+		if (!s.ok()) {
+			delete partitioned;
+			return s;
+		}
+		*result = partitioned;
+		return s;
+	}
+
+	~PartitionedDB() override {
+		for (rocksdb::ColumnFamilyHandle* handle : handles_) {
+			if (handle != nullptr) {db_->DestroyColumnFamilyHandle(handle);}
+		}
+	}
+
+	using rocksdb::StackableDB::Get;
+	using rocksdb::StackableDB::Put;
+	using rocksdb::StackableDB::Delete;
+	using rocksdb::StackableDB::DeleteRange;
+	using rocksdb::StackableDB::NewIterator;
+	using rocksdb::StackableDB::Flush;
+	using rocksdb::StackableDB::CompactRange;
+	using rocksdb::StackableDB::GetApproximateSizes;
+	using rocksdb::StackableDB::GetIntProperty;
+	using rocksdb::StackableDB::GetColumnFamilyMetaData;
+	using rocksdb::StackableDB::GetPropertiesOfAllTables;
+
+	rocksdb::Status Get(const rocksdb::ReadOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+			const rocksdb::Slice& key, rocksdb::PinnableSlice* value) override {
+		if (!isDefault(column_family)) {return rocksdb::StackableDB::Get(options, column_family, key, value);}
+		rocksdb::ColumnFamilyHandle* handle = handles_[partitionOf(key)];
+		if (handle == nullptr) {return rocksdb::Status::NotFound();}  // the partition was dropped
+		return rocksdb::StackableDB::Get(options, handle, key, value);
+	}
+
+	// writing into a dropped partition creates it again, empty
+	rocksdb::Status Put(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+			const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+		if (!isDefault(column_family)) {return rocksdb::StackableDB::Put(options, column_family, key, value);}
+		size_t p = partitionOf(key);
+		if (handles_[p] == nullptr) {
+			rocksdb::Status s = createPartition(p);
+			if (!s.ok()) {return s;}
+		}
+		return rocksdb::StackableDB::Put(options, handles_[p], key, value);
+	}
+
+	rocksdb::Status Delete(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+			const rocksdb::Slice& key) override {
+		if (!isDefault(column_family)) {return rocksdb::StackableDB::Delete(options, column_family, key);}
+		rocksdb::ColumnFamilyHandle* handle = handles_[partitionOf(key)];
+		if (handle == nullptr) {return rocksdb::Status::OK();}
+		return rocksdb::StackableDB::Delete(options, handle, key);
+	}
+
+	// drop the partitions inside [begin_key, end_key), range delete the partial ones at the edges
+	rocksdb::Status DeleteRange(const rocksdb::WriteOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+			const rocksdb::Slice& begin_key, const rocksdb::Slice& end_key) override {
+		if (!isDefault(column_family)) {
+			return rocksdb::StackableDB::DeleteRange(options, column_family, begin_key, end_key);
+		}
+		std::string begin = begin_key.ToString();
+		std::string end = end_key.ToString();
+		rocksdb::Status s;
+		for (size_t p = partitionOf(begin_key); p < handles_.size() && s.ok(); p++) {
+			bool hasLower = p > 0;
+			bool hasUpper = p < boundaries_.size();
+			if (hasLower && boundaries_[p - 1] >= end) {break;}
+			if (handles_[p] == nullptr) {continue;}
+			bool isCovered = hasLower && boundaries_[p - 1] >= begin && hasUpper && boundaries_[p] <= end;
+			if (isCovered) {
+				s = dropPartition(p);
+			}
+			else {
+				std::string from = hasLower ? std::max(begin, boundaries_[p - 1]) : begin;
+				std::string to = hasUpper ? std::min(end, boundaries_[p]) : end;
+				s = rocksdb::StackableDB::DeleteRange(options, handles_[p], from, to);
+			}
+		}
+		return s;
+	}
+
+	// the default column family entries of the batch are rewritten into their partitions, atomically
+	// range deletes only write tombstones here, dropping a partition cannot be part of a batch
+	rocksdb::Status Write(const rocksdb::WriteOptions& options, rocksdb::WriteBatch* updates) override {
+		RoutingHandler handler(this);
+		rocksdb::Status s = updates->Iterate(&handler);
+		if (!s.ok()) {return s;}
+		return rocksdb::StackableDB::Write(options, &handler.routed);
+	}
+
+	rocksdb::Iterator* NewIterator(const rocksdb::ReadOptions& options,
+			rocksdb::ColumnFamilyHandle* column_family) override {
+		if (!isDefault(column_family)) {return rocksdb::StackableDB::NewIterator(options, column_family);}
+		std::vector<rocksdb::ColumnFamilyHandle*> liveHandles;
+		for (rocksdb::ColumnFamilyHandle* handle : handles_) {
+			if (handle != nullptr) {liveHandles.push_back(handle);}
+		}
+		std::vector<rocksdb::Iterator*> liveIters;
+		rocksdb::Status s = db_->NewIterators(options, liveHandles, &liveIters);
+		if (!s.ok()) {return rocksdb::NewErrorIterator(s);}
+		std::vector<rocksdb::Iterator*> iters(handles_.size(), nullptr);
+		for (size_t p = 0, live = 0; p < handles_.size(); p++) {
+			if (handles_[p] != nullptr) {iters[p] = liveIters[live++];}
+		}
+		return new PartitionIterator(iters, boundaries_);
+	}
+
+	rocksdb::Status Flush(const rocksdb::FlushOptions& options, rocksdb::ColumnFamilyHandle* column_family) override {
+		if (!isDefault(column_family)) {return rocksdb::StackableDB::Flush(options, column_family);}
+		rocksdb::Status s;
+		for (size_t p = 0; p < handles_.size() && s.ok(); p++) {
+			if (handles_[p] != nullptr) {s = rocksdb::StackableDB::Flush(options, handles_[p]);}
+		}
+		return s;
+	}
+
+	rocksdb::Status CompactRange(const rocksdb::CompactRangeOptions& options, rocksdb::ColumnFamilyHandle* column_family,
+			const rocksdb::Slice* begin, const rocksdb::Slice* end) override {
+		if (!isDefault(column_family)) {return rocksdb::StackableDB::CompactRange(options, column_family, begin, end);}
+		rocksdb::Status s;
+		for (size_t p = 0; p < handles_.size() && s.ok(); p++) {
+			if (handles_[p] != nullptr) {s = rocksdb::StackableDB::CompactRange(options, handles_[p], begin, end);}
+		}
+		return s;
+	}
+
+	// the sizes of the default column family are the sums over the partitions
+	rocksdb::Status GetApproximateSizes(const rocksdb::SizeApproximationOptions& options,
+			rocksdb::ColumnFamilyHandle* column_family, const rocksdb::Range* ranges, int n, uint64_t* sizes) override {
+		if (!isDefault(column_family)) {
+			return rocksdb::StackableDB::GetApproximateSizes(options, column_family, ranges, n, sizes);
+		}
+		std::vector<uint64_t> partitionSizes(n);
+		for (int i = 0; i < n; i++) {sizes[i] = 0;}
+		for (rocksdb::ColumnFamilyHandle* handle : handles_) {
+			if (handle == nullptr) {continue;}
+			rocksdb::Status s = rocksdb::StackableDB::GetApproximateSizes(options, handle, ranges, n, partitionSizes.data());
+			if (!s.ok()) {return s;}
+			for (int i = 0; i < n; i++) {sizes[i] += partitionSizes[i];}
+		}
+		return rocksdb::Status::OK();
+	}
+
+	bool GetIntProperty(rocksdb::ColumnFamilyHandle* column_family, const rocksdb::Slice& property,
+			uint64_t* value) override {
+		if (!isDefault(column_family)) {return rocksdb::StackableDB::GetIntProperty(column_family, property, value);}
+		return db_->GetAggregatedIntProperty(property, value);
+	}
+
+	// the levels of the default column family hold the files of all partitions
+	void GetColumnFamilyMetaData(rocksdb::ColumnFamilyHandle* column_family, rocksdb::ColumnFamilyMetaData* metadata) override {
+		if (!isDefault(column_family)) {
+			rocksdb::StackableDB::GetColumnFamilyMetaData(column_family, metadata);
+			return;
+		}
+		metadata->name = rocksdb::kDefaultColumnFamilyName;
+		metadata->size = 0;
+		metadata->file_count = 0;
+		metadata->blob_file_size = 0;
+		metadata->blob_file_count = 0;
+		metadata->blob_files.clear();
+		metadata->levels.clear();
+		std::vector<uint64_t> levelSizes;
+		std::vector<std::vector<rocksdb::SstFileMetaData>> levelFiles;
+		for (rocksdb::ColumnFamilyHandle* handle : handles_) {
+			if (handle == nullptr) {continue;}
+			rocksdb::ColumnFamilyMetaData partition;
+			rocksdb::StackableDB::GetColumnFamilyMetaData(handle, &partition);
+			metadata->size += partition.size;
+			metadata->file_count += partition.file_count;
+			metadata->blob_file_size += partition.blob_file_size;
+			metadata->blob_file_count += partition.blob_file_count;
+			metadata->blob_files.insert(metadata->blob_files.end(), partition.blob_files.begin(), partition.blob_files.end());
+			if (levelFiles.size() < partition.levels.size()) {
+				levelSizes.resize(partition.levels.size(), 0);
+				levelFiles.resize(partition.levels.size());
+			}
+			for (const rocksdb::LevelMetaData& level : partition.levels) {
+				levelSizes[level.level] += level.size;
+				levelFiles[level.level].insert(levelFiles[level.level].end(), level.files.begin(), level.files.end());
+			}
+		}
+		for (size_t level = 0; level < levelFiles.size(); level++) {
+			metadata->levels.emplace_back((int)level, levelSizes[level], std::move(levelFiles[level]));
+		}
+	}
+
+	// the table properties of the default column family are those of all partitions
+	rocksdb::Status GetPropertiesOfAllTables(rocksdb::ColumnFamilyHandle* column_family,
+			rocksdb::TablePropertiesCollection* props) override {
+		if (!isDefault(column_family)) {return rocksdb::StackableDB::GetPropertiesOfAllTables(column_family, props);}
+		props->clear();
+		for (rocksdb::ColumnFamilyHandle* handle : handles_) {
+			if (handle == nullptr) {continue;}
+			rocksdb::TablePropertiesCollection partitionProps;
+			rocksdb::Status s = rocksdb::StackableDB::GetPropertiesOfAllTables(handle, &partitionProps);
+			if (!s.ok()) {return s;}
+			props->insert(partitionProps.begin(), partitionProps.end());
+		}
+		return rocksdb::Status::OK();
+	}
+
+	size_t numPartitions() const {return handles_.size();}
+
+	size_t numDroppedPartitions() const {
+		return std::count(handles_.begin(), handles_.end(), nullptr);
+	}
+
+private:
+	// copies a batch, moving the default column family entries into their partitions
+	class RoutingHandler : public rocksdb::WriteBatch::Handler {
+	public:
+		explicit RoutingHandler(PartitionedDB* db) : db_(db) {}
+
+		rocksdb::Status PutCF(uint32_t column_family_id, const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+			rocksdb::ColumnFamilyHandle* handle = nullptr;
+			rocksdb::Status s = db_->routeWrite(column_family_id, key, &handle);
+			return s.ok() ? routed.Put(handle, key, value) : s;
+		}
+
+		rocksdb::Status MergeCF(uint32_t column_family_id, const rocksdb::Slice& key, const rocksdb::Slice& value) override {
+			rocksdb::ColumnFamilyHandle* handle = nullptr;
+			rocksdb::Status s = db_->routeWrite(column_family_id, key, &handle);
+			return s.ok() ? routed.Merge(handle, key, value) : s;
+		}
+
+		// a key in a dropped partition is already gone
+		rocksdb::Status DeleteCF(uint32_t column_family_id, const rocksdb::Slice& key) override {
+			rocksdb::ColumnFamilyHandle* handle = db_->routeRead(column_family_id, key);
+			return handle != nullptr ? routed.Delete(handle, key) : rocksdb::Status::OK();
+		}
+
+		rocksdb::Status SingleDeleteCF(uint32_t column_family_id, const rocksdb::Slice& key) override {
+			rocksdb::ColumnFamilyHandle* handle = db_->routeRead(column_family_id, key);
+			return handle != nullptr ? routed.SingleDelete(handle, key) : rocksdb::Status::OK();
+		}
+
+		rocksdb::Status DeleteRangeCF(uint32_t column_family_id, const rocksdb::Slice& begin_key,
+				const rocksdb::Slice& end_key) override {
+			if (column_family_id != 0) {
+				rocksdb::ColumnFamilyHandle* handle = db_->routeRead(column_family_id, begin_key);
+				if (handle == nullptr) {return rocksdb::Status::NotSupported("unknown column family in batch");}
+				return routed.DeleteRange(handle, begin_key, end_key);
+			}
+			std::string begin = begin_key.ToString();
+			std::string end = end_key.ToString();
+			rocksdb::Status s;
+			for (size_t p = db_->partitionOf(begin_key); p < db_->handles_.size() && s.ok(); p++) {
+				bool hasLower = p > 0;
+				bool hasUpper = p < db_->boundaries_.size();
+				if (hasLower && db_->boundaries_[p - 1] >= end) {break;}
+				if (db_->handles_[p] == nullptr) {continue;}
+				std::string from = hasLower ? std::max(begin, db_->boundaries_[p - 1]) : begin;
+				std::string to = hasUpper ? std::min(end, db_->boundaries_[p]) : end;
+				s = routed.DeleteRange(db_->handles_[p], from, to);
+			}
+			return s;
+		}
+
+		rocksdb::WriteBatch routed;
+
+	private:
+		PartitionedDB* db_;
+	};
+
+	// the partition handle for a key of the default column family, or the handle of a partition
+	// addressed directly; nullptr for a dropped partition or an unknown column family
+	rocksdb::ColumnFamilyHandle* routeRead(uint32_t column_family_id, const rocksdb::Slice& key) const {
+		if (column_family_id == 0) {return handles_[partitionOf(key)];}
+		for (rocksdb::ColumnFamilyHandle* handle : handles_) {
+			if (handle != nullptr && handle->GetID() == column_family_id) {return handle;}
+		}
+		return nullptr;
+	}
+
+	// like routeRead, but a dropped partition is created again for the write
+	rocksdb::Status routeWrite(uint32_t column_family_id, const rocksdb::Slice& key, rocksdb::ColumnFamilyHandle** handle) {
+		if (column_family_id == 0 && handles_[partitionOf(key)] == nullptr) {
+			rocksdb::Status s = createPartition(partitionOf(key));
+			if (!s.ok()) {return s;}
+		}
+		*handle = routeRead(column_family_id, key);
+		if (*handle == nullptr) {return rocksdb::Status::NotSupported("unknown column family in batch");}
+		return rocksdb::Status::OK();
+	}
+
+	PartitionedDB(rocksdb::DB* db, const rocksdb::ColumnFamilyOptions& cfOptions, const std::vector<std::string>& boundaries)
+		: rocksdb::StackableDB(db), cfOptions_(cfOptions), boundaries_(boundaries), handles_(boundaries.size() + 1, nullptr) {}
+
+	size_t partitionOf(const rocksdb::Slice& key) const {
+		return std::upper_bound(boundaries_.begin(), boundaries_.end(), key.ToString()) - boundaries_.begin();
+	}
+
+	rocksdb::Status createPartition(size_t p) {
+		return db_->CreateColumnFamily(cfOptions_, "partition_" + std::to_string(p), &handles_[p]);
+	}
+
+	rocksdb::Status dropPartition(size_t p) {
+		rocksdb::Status s = db_->DropColumnFamily(handles_[p]);
+		if (!s.ok()) {return s;}
+		// the files are deleted once the last handle is gone
+		s = db_->DestroyColumnFamilyHandle(handles_[p]);
+		handles_[p] = nullptr;
+		return s;
+	}
+
+	bool isDefault(rocksdb::ColumnFamilyHandle* column_family) const {
+		return column_family == nullptr || column_family->GetID() == 0;
+	}
+
+	rocksdb::ColumnFamilyOptions cfOptions_;
+	std::vector<std::string> boundaries_;
+	std::vector<rocksdb::ColumnFamilyHandle*> handles_;  // nullptr for a dropped partition
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "rocksdb/iostats_context.h"
+#include "rocksdb/perf_context.h"
+
+// Structured perf context report: one line per counter, as total and per operation of the phase,
+// so runs compare line by line. The range delete counters come first; the times are in nanoseconds.
+
+struct PerfField {
+	const char* name;
+	uint64_t rocksdb::PerfContext::*counter;
+};
+
+static const PerfField kPerfFields[] = {
+	// range tombstones and the entries they hide
+	{"internal_range_del_reseek_count", &rocksdb::PerfContext::internal_range_del_reseek_count},
+	{"internal_delete_skipped_count", &rocksdb::PerfContext::internal_delete_skipped_count},
+	{"internal_key_skipped_count", &rocksdb::PerfContext::internal_key_skipped_count},
+	{"internal_recent_skipped_count", &rocksdb::PerfContext::internal_recent_skipped_count},
+	// blocks and filters
+	{"block_read_count", &rocksdb::PerfContext::block_read_count},
+	{"block_read_byte", &rocksdb::PerfContext::block_read_byte},
+	{"block_read_time", &rocksdb::PerfContext::block_read_time},
+	{"block_cache_hit_count", &rocksdb::PerfContext::block_cache_hit_count},
+	{"block_seek_nanos", &rocksdb::PerfContext::block_seek_nanos},
+	{"block_decompress_time", &rocksdb::PerfContext::block_decompress_time},
+	{"bloom_memtable_hit_count", &rocksdb::PerfContext::bloom_memtable_hit_count},
+	{"bloom_memtable_miss_count", &rocksdb::PerfContext::bloom_memtable_miss_count},
+	{"bloom_sst_hit_count", &rocksdb::PerfContext::bloom_sst_hit_count},
+	{"bloom_sst_miss_count", &rocksdb::PerfContext::bloom_sst_miss_count},
+	{"user_key_comparison_count", &rocksdb::PerfContext::user_key_comparison_count},
+	// Get
+	{"get_snapshot_time", &rocksdb::PerfContext::get_snapshot_time},
+	{"get_from_memtable_time", &rocksdb::PerfContext::get_from_memtable_time},
+	{"get_from_memtable_count", &rocksdb::PerfContext::get_from_memtable_count},
+	{"get_from_output_files_time", &rocksdb::PerfContext::get_from_output_files_time},
+	{"get_post_process_time", &rocksdb::PerfContext::get_post_process_time},
+	{"get_cpu_nanos", &rocksdb::PerfContext::get_cpu_nanos},
+	// iterators
+	{"seek_on_memtable_time", &rocksdb::PerfContext::seek_on_memtable_time},
+	{"next_on_memtable_count", &rocksdb::PerfContext::next_on_memtable_count},
+	{"seek_internal_seek_time", &rocksdb::PerfContext::seek_internal_seek_time},
+	{"find_next_user_entry_time", &rocksdb::PerfContext::find_next_user_entry_time},
+	{"iter_seek_cpu_nanos", &rocksdb::PerfContext::iter_seek_cpu_nanos},
+	{"iter_next_cpu_nanos", &rocksdb::PerfContext::iter_next_cpu_nanos},
+	// writes
+	{"write_memtable_time", &rocksdb::PerfContext::write_memtable_time},
+	{"write_wal_time", &rocksdb::PerfContext::write_wal_time},
+};
+
+// start a phase; the contexts are thread-local, so reset this thread's, not a copy
+inline void resetPerfContexts() {
+	rocksdb::get_perf_context()->Reset();
+	rocksdb::get_iostats_context()->Reset();
+}
+
+// the counters of this thread since the last reset, over numOps operations named opName
+inline void printPerfReport(const std::string& phase, const std::string& opName, uint64_t numOps) {
+	const rocksdb::PerfContext* perf = rocksdb::get_perf_context();
+	printf("perf_context %s (%llu %s):\n", phase.c_str(), (unsigned long long)numOps, opName.c_str());
+	for (const PerfField& field : kPerfFields) {
+		uint64_t total = perf->*field.counter;
+		printf("  %s: %llu total, %.3f per %s\n", field.name, (unsigned long long)total,
+			numOps > 0 ? (double)total / numOps : 0.0, opName.c_str());
+	}
+	const rocksdb::IOStatsContext* ioStats = rocksdb::get_iostats_context();
+	printf("  iostats bytes_read: %llu total, %.3f per %s\n", (unsigned long long)ioStats->bytes_read,
+		numOps > 0 ? (double)ioStats->bytes_read / numOps : 0.0, opName.c_str());
+}
+
+// per-level counters of this thread since the last reset, needs EnablePerLevelPerfContext() first
+// user_key_return_count shows which level served the reads, the bloom counters where the filter saved work
+inline void printPerLevelPerfReport(const std::string& phase, const std::string& opName, uint64_t numOps) {
+	const rocksdb::PerfContext* perf = rocksdb::get_perf_context();
+	printf("perf_context by level %s (%llu %s):\n", phase.c_str(), (unsigned long long)numOps, opName.c_str());
+	if (perf->level_to_perf_context == nullptr) {return;}
+	double ops = numOps > 0 ? (double)numOps : 1.0;
+	for (const auto& entry : *perf->level_to_perf_context) {
+		const rocksdb::PerfContextByLevel& level = entry.second;
+		printf("  L%u: user_key_return_count %.3f, bloom_filter_useful %.3f, bloom_filter_full_positive %.3f, "
+			"bloom_filter_full_true_positive %.3f, get_from_table_nanos %.1f, block_cache_hit_count %.3f, "
+			"block_cache_miss_count %.3f per %s\n", entry.first,
+			level.user_key_return_count / ops, level.bloom_filter_useful / ops, level.bloom_filter_full_positive / ops,
+			level.bloom_filter_full_true_positive / ops, level.get_from_table_nanos / ops, level.block_cache_hit_count / ops,
+			level.block_cache_miss_count / ops, opName.c_str());
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "rocksdb/statistics.h"
+
+// DB-wide tickers and histograms per phase. Statistics cannot subtract histograms, so instead of
+// diffing snapshots the object is reset at the start of each phase; the report at its end is then
+// the phase's diff. Unlike the perf context, the numbers include the background threads, so the
+// drivers also report the reclamation compaction and the tombstone compaction window as phases;
+// the read phases run without auto compactions and show no compaction I/O of their own.
+
+struct StatTicker {
+	const char* name;
+	rocksdb::Tickers ticker;
+};
+
+static const StatTicker kPhaseTickers[] = {
+	{"block.cache.hit", rocksdb::BLOCK_CACHE_HIT},
+	{"block.cache.miss", rocksdb::BLOCK_CACHE_MISS},
+	{"block.cache.data.hit", rocksdb::BLOCK_CACHE_DATA_HIT},
+	{"block.cache.data.miss", rocksdb::BLOCK_CACHE_DATA_MISS},
+	{"block.cache.index.hit", rocksdb::BLOCK_CACHE_INDEX_HIT},
+	{"block.cache.index.miss", rocksdb::BLOCK_CACHE_INDEX_MISS},
+	{"block.cache.filter.hit", rocksdb::BLOCK_CACHE_FILTER_HIT},
+	{"block.cache.filter.miss", rocksdb::BLOCK_CACHE_FILTER_MISS},
+	{"bloom.filter.useful", rocksdb::BLOOM_FILTER_USEFUL},
+	{"bloom.filter.full.positive", rocksdb::BLOOM_FILTER_FULL_POSITIVE},
+	{"bloom.filter.full.true.positive", rocksdb::BLOOM_FILTER_FULL_TRUE_POSITIVE},
+	{"memtable.hit", rocksdb::MEMTABLE_HIT},
+	{"memtable.miss", rocksdb::MEMTABLE_MISS},
+	{"get.hit.l0", rocksdb::GET_HIT_L0},
+	{"get.hit.l1", rocksdb::GET_HIT_L1},
+	{"get.hit.l2andup", rocksdb::GET_HIT_L2_AND_UP},
+	{"number.keys.read", rocksdb::NUMBER_KEYS_READ},
+	{"number.db.seek", rocksdb::NUMBER_DB_SEEK},
+	{"number.db.next", rocksdb::NUMBER_DB_NEXT},
+	{"bytes.read", rocksdb::BYTES_READ},
+	{"bytes.written", rocksdb::BYTES_WRITTEN},
+	{"db.iter.bytes.read", rocksdb::ITER_BYTES_READ},
+	{"compact.read.bytes", rocksdb::COMPACT_READ_BYTES},
+	{"compact.write.bytes", rocksdb::COMPACT_WRITE_BYTES},
+	{"flush.write.bytes", rocksdb::FLUSH_WRITE_BYTES},
+};
+
+struct StatHistogram {
+	const char* name;
+	rocksdb::Histograms histogram;
+};
+
+static const StatHistogram kPhaseHistograms[] = {
+	{"db.get.micros", rocksdb::DB_GET},
+	{"db.seek.micros", rocksdb::DB_SEEK},
+	{"db.write.micros", rocksdb::DB_WRITE},
+};
+
+class PhaseStatistics {
+public:
+	// statistics may be null, then every call does nothing
+	explicit PhaseStatistics(std::shared_ptr<rocksdb::Statistics> statistics) : statistics_(std::move(statistics)) {}
+
+	void start() {
+		if (statistics_ != nullptr) {statistics_->Reset();}
+	}
+
+	void print(const std::string& phase) const {
+		if (statistics_ == nullptr) {return;}
+		printf("statistics %s:\n", phase.c_str());
+		for (const StatTicker& ticker : kPhaseTickers) {
+			printf("  %s: %llu\n", ticker.name, (unsigned long long)statistics_->getTickerCount(ticker.ticker));
+		}
+		for (const StatHistogram& histogram : kPhaseHistograms) {
+			rocksdb::HistogramData data;
+			statistics_->histogramData(histogram.histogram, &data);
+			if (data.count == 0) {continue;}
+			printf("  %s: count %llu, avg %.3f, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f\n", histogram.name,
+				(unsigned long long)data.count, data.average, data.median, data.percentile95, data.percentile99, data.max);
+		}
+	}
+
+private:
+	std::shared_ptr<rocksdb::Statistics> statistics_;
+};
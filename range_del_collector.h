@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/metadata.h"
+#include "rocksdb/table_properties.h"
+
+// RocksDB's CompactOnDeletionCollector only looks at point deletions, so a file holding
+// range tombstones is never picked early. This collector counts the range tombstones of each
+// SST, estimates how many keys they cover and marks the file for compaction once the covered
+// keys outnumber the file's own entries by the given density.
+
+// estimate the number of keys in [start, end)
+// the drivers use fixed-width decimal keys, other keys fall back to their first 8 bytes
+inline uint64_t estimateKeySpan(const rocksdb::Slice& start, const rocksdb::Slice& end) {
+	bool isDecimal = start.size() == end.size() && start.size() > 0 && start.size() <= 18;
+	for (size_t i = 0; isDecimal && i < start.size(); i++) {
+		isDecimal = isdigit(start[i]) && isdigit(end[i]);
+	}
+	if (isDecimal) {
+		uint64_t startNum = std::stoull(start.ToString());
+		uint64_t endNum = std::stoull(end.ToString());
+		return endNum > startNum ? endNum - startNum : 0;
+	}
+	uint64_t startNum = 0;
+	uint64_t endNum = 0;
+	for (size_t i = 0; i < 8; i++) {
+		startNum = (startNum << 8) | (i < start.size() ? (unsigned char)start[i] : 0);
+		endNum = (endNum << 8) | (i < end.size() ? (unsigned char)end[i] : 0);
+	}
+	return endNum > startNum ? endNum - startNum : 0;
+}
+
+class RangeDelDensityCollector : public rocksdb::TablePropertiesCollector {
+public:
+	explicit RangeDelDensityCollector(double density) : density_(density) {}
+
+	// range tombstones reach the collectors as kEntryRangeDeletion, with the end key as the value,
+	// and are not counted as entries of the file
+	rocksdb::Status AddUserKey(const rocksdb::Slice& key, const rocksdb::Slice& value, rocksdb::EntryType type,
+			rocksdb::SequenceNumber /*seq*/, uint64_t /*file_size*/) override {
+		if (type == rocksdb::kEntryRangeDeletion) {
+			numRangeDels_++;
+			coveredKeys_ += estimateKeySpan(key, value);
+		}
+		else {
+			numEntries_++;
+		}
+		return rocksdb::Status::OK();
+	}
+
+	rocksdb::Status Finish(rocksdb::UserCollectedProperties* properties) override {
+		*properties = GetReadableProperties();
+		return rocksdb::Status::OK();
+	}
+
+	rocksdb::UserCollectedProperties GetReadableProperties() const override {
+		return rocksdb::UserCollectedProperties{
+			{"rangedel.num-range-tombstones", std::to_string(numRangeDels_)},
+			{"rangedel.estimated-covered-keys", std::to_string(coveredKeys_)},
+		};
+	}
+
+	bool NeedCompact() const override {
+		if (numRangeDels_ == 0) {return false;}
+		return coveredKeys_ >= density_ * std::max<uint64_t>(numEntries_, 1);
+	}
+
+	const char* Name() const override {return "RangeDelDensityCollector";}
+
+private:
+	double density_;
+	uint64_t numRangeDels_ = 0;
+	uint64_t coveredKeys_ = 0;
+	uint64_t numEntries_ = 0;
+};
+
+class RangeDelDensityCollectorFactory : public rocksdb::TablePropertiesCollectorFactory {
+public:
+	explicit RangeDelDensityCollectorFactory(double density) : density_(density) {}
+
+	rocksdb::TablePropertiesCollector* CreateTablePropertiesCollector(
+			rocksdb::TablePropertiesCollectorFactory::Context /*context*/) override {
+		return new RangeDelDensityCollector(density_);
+	}
+
+	const char* Name() const override {return "RangeDelDensityCollectorFactory";}
+
+private:
+	double density_;
+};
+
+// number of range tombstones in all live SST files
+inline uint64_t countRangeTombstones(rocksdb::DB* db) {
+	rocksdb::TablePropertiesCollection props;
+	if (!db->GetPropertiesOfAllTables(&props).ok()) {return 0;}
+	uint64_t count = 0;
+	for (auto& entry : props) {count += entry.second->num_range_deletions;}
+	return count;
+}
+
+// number of live SST files marked for compaction
+inline int countMarkedFiles(rocksdb::DB* db) {
+	rocksdb::ColumnFamilyMetaData meta;
+	db->GetColumnFamilyMetaData(&meta);
+	int count = 0;
+	for (auto& level : meta.levels) {
+		for (auto& file : level.files) {
+			if (file.marked_for_compaction) {count++;}
+		}
+	}
+	return count;
+}
+
+// read latency while background compaction removes the range tombstones
+struct TombstoneWindowResult {
+	double seconds = 0.0;  // time until no SST holds a range tombstone, or the timeout
+	bool isCleared = false;
+	uint64_t numReads = 0;
+	double avgMicros = 0.0;
+	double p50Micros = 0.0;
+	double p99Micros = 0.0;
+	double maxMicros = 0.0;
+};
+
+// keep reading until the tombstones are compacted away, checking the SSTs every pollMillis
+// only SST files are checked, so flush the memtable holding the tombstones before the window starts
+// latencies use wall-clock time: clock() would also count the CPU of the compaction threads
+inline TombstoneWindowResult measureTombstoneWindow(rocksdb::DB* db, std::function<std::string()> nextKey,
+		int timeoutSeconds, int pollMillis) {
+	TombstoneWindowResult result;
+	std::vector<double> latencies;
+	std::string value;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point nextPoll = start;
+	while (true) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now >= nextPoll) {
+			if (countRangeTombstones(db) == 0) {result.isCleared = true; break;}
+			if (now - start >= std::chrono::seconds(timeoutSeconds)) {break;}
+			nextPoll = now + std::chrono::milliseconds(pollMillis);
+		}
+		std::string key = nextKey();
+		std::chrono::steady_clock::time_point readStart = std::chrono::steady_clock::now();
+		rocksdb::Status s = db->Get(rocksdb::ReadOptions(), key, &value);
+		std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - readStart;
+		assert(s.ok() || s.IsNotFound());  // make sure to check error
+		latencies.push_back(latency.count());
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	result.seconds = elapsed.count();
+	result.numReads = latencies.size();
+	if (!latencies.empty()) {
+		std::sort(latencies.begin(), latencies.end());
+		double total = 0.0;
+		for (double latency : latencies) {total += latency;}
+		result.avgMicros = total / latencies.size();
+		result.p50Micros = latencies[latencies.size() / 2];
+		result.p99Micros = latencies[latencies.size() * 99 / 100];
+		result.maxMicros = latencies.back();
+	}
+	return result;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/listener.h"
+#include "rocksdb/options.h"
+
+// collect the I/O of the manual compactions that finish while the DB is open
+// auto compactions can run next to the reclamation compaction, so they are left out
+class CompactionStatsListener : public rocksdb::EventListener {
+public:
+	void OnCompactionCompleted(rocksdb::DB* /*db*/, const rocksdb::CompactionJobInfo& info) override {
+		if (info.compaction_reason != rocksdb::CompactionReason::kManualCompaction) {return;}
+		numCompactions_++;
+		bytesRead_ += info.stats.total_input_bytes;
+		bytesWritten_ += info.stats.total_output_bytes;
+		inputRecords_ += info.stats.num_input_records;
+		outputRecords_ += info.stats.num_output_records;
+	}
+
+	void reset() {
+		numCompactions_ = 0;
+		bytesRead_ = 0;
+		bytesWritten_ = 0;
+		inputRecords_ = 0;
+		outputRecords_ = 0;
+	}
+
+	uint64_t numCompactions() const {return numCompactions_;}
+	uint64_t bytesRead() const {return bytesRead_;}
+	uint64_t bytesWritten() const {return bytesWritten_;}
+	uint64_t inputRecords() const {return inputRecords_;}
+	uint64_t outputRecords() const {return outputRecords_;}
+
+private:
+	std::atomic<uint64_t> numCompactions_{0};
+	std::atomic<uint64_t> bytesRead_{0};
+	std::atomic<uint64_t> bytesWritten_{0};
+	std::atomic<uint64_t> inputRecords_{0};
+	std::atomic<uint64_t> outputRecords_{0};
+};
+
+// result of compacting the deleted ranges
+struct ReclaimResult {
+	double seconds = 0.0;  // wall-clock time of all the CompactRange calls
+	uint64_t numCompactions = 0;
+	uint64_t bytesRead = 0;
+	uint64_t bytesWritten = 0;
+	uint64_t recordsDropped = 0;
+	uint64_t sstSizeBefore = 0;  // total SST file size before the compaction
+	uint64_t sstSizeAfter = 0;
+};
+
+// compact exactly the deleted ranges down to the bottommost level, so the range tombstones
+// and the data they cover are dropped instead of being pushed to the next level
+inline rocksdb::Status reclaimDeletedRanges(rocksdb::DB* db, const std::vector<std::pair<std::string, std::string>>& ranges,
+		int maxSubcompactions, CompactionStatsListener* listener, ReclaimResult* result) {
+	rocksdb::CompactRangeOptions CROptions;
+	CROptions.bottommost_level_compaction = rocksdb::BottommostLevelCompaction::kForce;
+	CROptions.max_subcompactions = maxSubcompactions;
+	db->GetIntProperty(rocksdb::DB::Properties::kTotalSstFilesSize, &result->sstSizeBefore);
+	listener->reset();
+	// compactions run on background threads, so measure wall-clock time instead of clock()
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	rocksdb::Status s;
+	for (size_t i = 0; i < ranges.size() && s.ok(); i++) {
+		rocksdb::Slice begin = ranges[i].first;
+		rocksdb::Slice end = ranges[i].second;
+		s = db->CompactRange(CROptions, &begin, &end);
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	result->seconds = elapsed.count();
+	result->numCompactions = listener->numCompactions();
+	result->bytesRead = listener->bytesRead();
+	result->bytesWritten = listener->bytesWritten();
+	result->recordsDropped = listener->inputRecords() - listener->outputRecords();
+	db->GetIntProperty(rocksdb::DB::Properties::kTotalSstFilesSize, &result->sstSizeAfter);
+	return s;
+}
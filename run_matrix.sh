@@ -0,0 +1,30 @@
+#!/bin/bash
+# run one test driver once per value of an option, starting each run from an empty DB
+# usage: ./run_matrix.sh <driver> <option> <value>... [-- <other options>]
+# e.g.   ./run_matrix.sh ./test_point3WF compaction_style level universal fifo none -- --settle_seconds=120
+# the output of each run goes to <driver>_<option>_<value>.txt
+# the DB lives in $DB_PATH, which is passed to the driver as --db_path
+
+DB_PATH=${DB_PATH:-/tmp/rocksdb_project}
+
+if [ $# -lt 3 ]; then
+	echo "usage: $0 <driver> <option> <value>... [-- <other options>]"
+	exit 1
+fi
+
+DRIVER=$1
+OPTION=$2
+shift 2
+VALUES=()
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+	VALUES+=("$1")
+	shift
+done
+if [ "$1" == "--" ]; then shift; fi
+
+for VALUE in "${VALUES[@]}"; do
+	OUTPUT="$(basename "$DRIVER")_${OPTION}_${VALUE}.txt"
+	echo "Running $DRIVER --db_path=$DB_PATH --$OPTION=$VALUE $* > $OUTPUT"
+	rm -rf "$DB_PATH"
+	"$DRIVER" "--db_path=$DB_PATH" "--$OPTION=$VALUE" "$@" > "$OUTPUT" 2>&1
+done
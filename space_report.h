@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/iterator.h"
+#include "rocksdb/metadata.h"
+#include "rocksdb/options.h"
+#include "rocksdb/table_properties.h"
+#include "rocksdb/transaction_log.h"
+
+// Space and live data accounting: what the DB stores (SST files, blob files, memtables, WAL) against
+// what is actually live, counted exactly with a full scan rather than estimated. The approximate size
+// the drivers print leaves the memtables out and does not shrink after DeleteRange, so the space
+// amplification the range tombstones cause is only visible here.
+// The scan does not fill the block cache, but it does read every live key, so call this outside the
+// measured phases.
+
+struct SpaceReport {
+	uint64_t sstBytes = 0;
+	uint64_t blobBytes = 0;
+	uint64_t memtableBytes = 0;
+	uint64_t walBytes = 0;
+	uint64_t approximateBytes = 0;  // GetApproximateSizes over all keys, memtables included
+	uint64_t estimatedLiveBytes = 0;
+	uint64_t estimatedNumKeys = 0;
+	uint64_t storedEntries = 0;  // point entries in SST files and memtables, deletions included
+	uint64_t sstRangeDels = 0;
+	uint64_t liveKeys = 0;
+	uint64_t liveBytes = 0;
+};
+
+inline SpaceReport measureSpace(rocksdb::DB* db) {
+	SpaceReport report;
+	// summed over the column families, so partitions count as well
+	db->GetAggregatedIntProperty(rocksdb::DB::Properties::kTotalSstFilesSize, &report.sstBytes);
+	db->GetAggregatedIntProperty(rocksdb::DB::Properties::kTotalBlobFileSize, &report.blobBytes);
+	db->GetAggregatedIntProperty(rocksdb::DB::Properties::kCurSizeAllMemTables, &report.memtableBytes);
+	db->GetAggregatedIntProperty(rocksdb::DB::Properties::kEstimateLiveDataSize, &report.estimatedLiveBytes);
+	db->GetAggregatedIntProperty(rocksdb::DB::Properties::kEstimateNumKeys, &report.estimatedNumKeys);
+	uint64_t activeEntries = 0;
+	uint64_t immutableEntries = 0;
+	db->GetAggregatedIntProperty(rocksdb::DB::Properties::kNumEntriesActiveMemTable, &activeEntries);
+	db->GetAggregatedIntProperty(rocksdb::DB::Properties::kNumEntriesImmMemTables, &immutableEntries);
+	report.storedEntries = activeEntries + immutableEntries;
+	std::vector<rocksdb::LiveFileMetaData> files;
+	db->GetLiveFilesMetaData(&files);
+	for (const rocksdb::LiveFileMetaData& file : files) {report.storedEntries += file.num_entries;}
+	rocksdb::TablePropertiesCollection props;
+	db->GetPropertiesOfAllTables(&props);
+	for (const auto& entry : props) {report.sstRangeDels += entry.second->num_range_deletions;}
+	rocksdb::VectorLogPtr walFiles;
+	if (db->GetSortedWalFiles(walFiles).ok()) {
+		for (const std::unique_ptr<rocksdb::LogFile>& wal : walFiles) {
+			if (wal->Type() == rocksdb::kAliveLogFile) {report.walBytes += wal->SizeFileBytes();}
+		}
+	}
+	// the keys are printable, so ["", "\xff") covers all of them
+	rocksdb::Range allKeys("", "\xff");
+	rocksdb::SizeApproximationOptions sizeOptions;
+	sizeOptions.include_memtables = true;
+	sizeOptions.files_size_error_margin = -1.0;
+	db->GetApproximateSizes(sizeOptions, db->DefaultColumnFamily(), &allKeys, 1, &report.approximateBytes);
+	rocksdb::ReadOptions scanOptions;
+	scanOptions.total_order_seek = true;
+	scanOptions.fill_cache = false;
+	std::unique_ptr<rocksdb::Iterator> iter(db->NewIterator(scanOptions));
+	for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+		report.liveKeys++;
+		report.liveBytes += iter->key().size() + iter->value().size();
+	}
+	return report;
+}
+
+// numKeysInserted is the number of distinct keys the test wrote, the ones not live any more are dead
+inline void printSpaceReport(rocksdb::DB* db, const std::string& info, uint64_t numKeysInserted) {
+	SpaceReport report = measureSpace(db);
+	uint64_t storedBytes = report.sstBytes + report.blobBytes + report.memtableBytes;
+	uint64_t deadKeys = numKeysInserted > report.liveKeys ? numKeysInserted - report.liveKeys : 0;
+	printf("Space %s:\n", info.c_str());
+	printf("  SST files: %llu bytes, blob files: %llu bytes, memtables: %llu bytes, WAL: %llu bytes\n",
+		(unsigned long long)report.sstBytes, (unsigned long long)report.blobBytes,
+		(unsigned long long)report.memtableBytes, (unsigned long long)report.walBytes);
+	printf("  Approximate size with memtables: %llu bytes\n", (unsigned long long)report.approximateBytes);
+	printf("  Live data: %llu bytes exact, %llu bytes estimated\n",
+		(unsigned long long)report.liveBytes, (unsigned long long)report.estimatedLiveBytes);
+	printf("  Live keys: %llu exact, %llu estimated; dead keys: %llu\n", (unsigned long long)report.liveKeys,
+		(unsigned long long)report.estimatedNumKeys, (unsigned long long)deadKeys);
+	printf("  Stored point entries: %llu, range tombstones in SST files: %llu\n",
+		(unsigned long long)report.storedEntries, (unsigned long long)report.sstRangeDels);
+	// stored over live: above 1 is data the deletes made unreachable but did not free yet,
+	// compressed SST files pull the ratio down by their compression ratio
+	printf("  Space amplification: %.3f, entries per live key: %.3f\n",
+		report.liveBytes > 0 ? (double)storedBytes / report.liveBytes : 0.0,
+		report.liveKeys > 0 ? (double)report.storedEntries / report.liveKeys : 0.0);
+}
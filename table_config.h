@@ -0,0 +1,251 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "rocksdb/cache.h"
+#include "rocksdb/db.h"
+#include "rocksdb/filter_policy.h"
+#include "rocksdb/options.h"
+#include "rocksdb/perf_context.h"
+#include "rocksdb/slice_transform.h"
+#include "rocksdb/table.h"
+#include "rocksdb/table_properties.h"
+
+// Table configuration sweeps. The drivers leave BlockBasedTableOptions at the defaults;
+// these helpers set one group of table options each from the command-line flags,
+// the table format first since the filter and cache settings depend on it.
+
+// table format: data block size and restart interval, the data block index ("binary" or "binary_and_hash"
+// with its hash table utilization ratio), the index type ("binary", "hash" or "two_level") and the format version
+// the hash index looks blocks up by key prefix, so it needs a prefix extractor
+inline rocksdb::Status configureTableFormat(rocksdb::BlockBasedTableOptions* tableOptions, int blockSize,
+		int blockRestartInterval, const std::string& dataBlockIndex, double dataBlockHashRatio, const std::string& indexType,
+		int formatVersion, bool hasPrefixExtractor) {
+	tableOptions->block_size = blockSize;
+	tableOptions->block_restart_interval = blockRestartInterval;
+	tableOptions->format_version = formatVersion;
+	if (dataBlockIndex == "binary_and_hash") {
+		tableOptions->data_block_index_type = rocksdb::BlockBasedTableOptions::kDataBlockBinaryAndHash;
+		tableOptions->data_block_hash_table_util_ratio = dataBlockHashRatio;
+	}
+	else if (dataBlockIndex != "binary") {
+		return rocksdb::Status::InvalidArgument("unknown data block index: " + dataBlockIndex);
+	}
+	if (indexType == "hash") {
+		if (!hasPrefixExtractor) {return rocksdb::Status::InvalidArgument("the hash index needs prefix_len");}
+		tableOptions->index_type = rocksdb::BlockBasedTableOptions::kHashSearch;
+	}
+	else if (indexType == "two_level") {
+		tableOptions->index_type = rocksdb::BlockBasedTableOptions::kTwoLevelIndexSearch;
+	}
+	else if (indexType != "binary") {
+		return rocksdb::Status::InvalidArgument("unknown index type: " + indexType);
+	}
+	return rocksdb::Status::OK();
+}
+
+// filter policy: "bloom" or "ribbon" at bitsPerKey, 0 for the default 10 bits; empty for no filter,
+// where the other filter options must keep their defaults instead of being ignored
+// partitioned filters need the two-level index, configureTableFormat must have set it, and a
+// prefix-only filter needs the prefix extractor, configurePrefix must have set it
+inline rocksdb::Status configureFilter(rocksdb::BlockBasedTableOptions* tableOptions, rocksdb::Options* options,
+		const std::string& filterPolicy, double bitsPerKey, bool isWholeKeyFiltering, bool isPartitionedFilter,
+		bool isOptimizeFiltersForHits) {
+	if (filterPolicy.empty()) {
+		if (bitsPerKey > 0.0 || !isWholeKeyFiltering || isPartitionedFilter || isOptimizeFiltersForHits) {
+			return rocksdb::Status::InvalidArgument("filter options given without a filter");
+		}
+		return rocksdb::Status::OK();
+	}
+	if (isPartitionedFilter && tableOptions->index_type != rocksdb::BlockBasedTableOptions::kTwoLevelIndexSearch) {
+		return rocksdb::Status::InvalidArgument("partitioned filters need index_type=two_level");
+	}
+	if (!isWholeKeyFiltering && options->prefix_extractor == nullptr) {
+		return rocksdb::Status::InvalidArgument("whole_key_filtering=false needs prefix_len");
+	}
+	if (bitsPerKey <= 0.0) {bitsPerKey = 10.0;}
+	if (filterPolicy == "bloom") {
+		tableOptions->filter_policy.reset(rocksdb::NewBloomFilterPolicy(bitsPerKey, false));
+	}
+	else if (filterPolicy == "ribbon") {
+		tableOptions->filter_policy.reset(rocksdb::NewRibbonFilterPolicy(bitsPerKey));
+	}
+	else {
+		return rocksdb::Status::InvalidArgument("unknown filter policy: " + filterPolicy);
+	}
+	tableOptions->whole_key_filtering = isWholeKeyFiltering;
+	tableOptions->partition_filters = isPartitionedFilter;
+	// no filters on the last level, where most point reads for existing keys end
+	options->optimize_filters_for_hits = isOptimizeFiltersForHits;
+	return rocksdb::Status::OK();
+}
+
+// the fixed-width keys share their leading digits, a prefix of prefixLen characters
+// groups 10^(keyLen - prefixLen) consecutive keys; 0 leaves the prefix extractor unset
+inline void configurePrefix(rocksdb::Options* options, int prefixLen) {
+	if (prefixLen > 0) {options->prefix_extractor.reset(rocksdb::NewFixedPrefixTransform(prefixLen));}
+}
+
+// block cache: "lru" or "hyper_clock" of the given capacity, empty keeps RocksDB's default cache
+// numShardBits -1 lets RocksDB pick the shard count; the clock cache sizes its table by the block size
+inline rocksdb::Status configureBlockCache(rocksdb::BlockBasedTableOptions* tableOptions, const std::string& cacheType,
+		size_t capacity, int numShardBits, bool isCacheIndexAndFilterBlocks, bool isPinL0FilterAndIndexBlocks) {
+	tableOptions->cache_index_and_filter_blocks = isCacheIndexAndFilterBlocks;
+	tableOptions->pin_l0_filter_and_index_blocks_in_cache = isPinL0FilterAndIndexBlocks;
+	if (cacheType.empty()) {return rocksdb::Status::OK();}
+	if (cacheType == "lru") {
+		tableOptions->block_cache = rocksdb::NewLRUCache(capacity, numShardBits);
+	}
+	else if (cacheType == "hyper_clock") {
+		rocksdb::HyperClockCacheOptions cacheOptions(capacity, tableOptions->block_size, numShardBits);
+		tableOptions->block_cache = cacheOptions.MakeSharedCache();
+	}
+	else {
+		return rocksdb::Status::InvalidArgument("unknown block cache: " + cacheType);
+	}
+	return rocksdb::Status::OK();
+}
+
+// block cache hits and misses by block type, from the reading thread's perf context
+// take one before a phase and subtract it from one taken after; the difference is that phase's reads
+struct BlockCacheCounters {
+	uint64_t dataHits = 0;
+	uint64_t dataMisses = 0;
+	uint64_t indexHits = 0;
+	uint64_t indexMisses = 0;
+	uint64_t filterHits = 0;
+	uint64_t filterMisses = 0;
+
+	static BlockCacheCounters current() {
+		const rocksdb::PerfContext* perf = rocksdb::get_perf_context();
+		BlockCacheCounters counters;
+		counters.indexHits = perf->block_cache_index_hit_count;
+		counters.indexMisses = perf->index_block_read_count;
+		counters.filterHits = perf->block_cache_filter_hit_count;
+		counters.filterMisses = perf->filter_block_read_count;
+		// the totals also count the index and filter blocks
+		counters.dataHits = perf->block_cache_hit_count - counters.indexHits - counters.filterHits;
+		counters.dataMisses = perf->block_read_count - counters.indexMisses - counters.filterMisses;
+		return counters;
+	}
+
+	BlockCacheCounters operator-(const BlockCacheCounters& other) const {
+		BlockCacheCounters diff;
+		diff.dataHits = dataHits - other.dataHits;
+		diff.dataMisses = dataMisses - other.dataMisses;
+		diff.indexHits = indexHits - other.indexHits;
+		diff.indexMisses = indexMisses - other.indexMisses;
+		diff.filterHits = filterHits - other.filterHits;
+		diff.filterMisses = filterMisses - other.filterMisses;
+		return diff;
+	}
+
+	void print(const std::string& info) const {
+		printf("Block cache hit rate %s: data %.4f (%llu/%llu), index %.4f (%llu/%llu), filter %.4f (%llu/%llu)\n", info.c_str(),
+			hitRate(dataHits, dataMisses), (unsigned long long)dataHits, (unsigned long long)(dataHits + dataMisses),
+			hitRate(indexHits, indexMisses), (unsigned long long)indexHits, (unsigned long long)(indexHits + indexMisses),
+			hitRate(filterHits, filterMisses), (unsigned long long)filterHits, (unsigned long long)(filterHits + filterMisses));
+	}
+
+private:
+	static double hitRate(uint64_t hits, uint64_t misses) {
+		return hits + misses > 0 ? (double)hits / (hits + misses) : 0.0;
+	}
+};
+
+// CPU time and blocks touched per Get of a phase, the blocks come from the phase's cache counters
+inline void printReadCost(const BlockCacheCounters& counters, int numGets, double cpuSeconds, const std::string& info) {
+	if (numGets == 0) {return;}
+	uint64_t blocksRead = counters.dataMisses + counters.indexMisses + counters.filterMisses;
+	uint64_t cacheHits = counters.dataHits + counters.indexHits + counters.filterHits;
+	printf("Per Get %s: %.3fus CPU, %.3f blocks read from files (data %.3f, index %.3f, filter %.3f), %.3f block cache hits\n",
+		info.c_str(), cpuSeconds * 1000000.0 / numGets, (double)blocksRead / numGets, (double)counters.dataMisses / numGets,
+		(double)counters.indexMisses / numGets, (double)counters.filterMisses / numGets, (double)cacheHits / numGets);
+}
+
+// capacity, usage and pinned usage of the block cache, whichever cache the DB runs with
+inline void printBlockCacheUsage(rocksdb::DB* db, const std::string& info) {
+	uint64_t capacity = 0;
+	uint64_t usage = 0;
+	uint64_t pinnedUsage = 0;
+	db->GetIntProperty(rocksdb::DB::Properties::kBlockCacheCapacity, &capacity);
+	db->GetIntProperty(rocksdb::DB::Properties::kBlockCacheUsage, &usage);
+	db->GetIntProperty(rocksdb::DB::Properties::kBlockCachePinnedUsage, &pinnedUsage);
+	std::cout << "Block cache " << info << ": capacity " << capacity << " bytes, usage " << usage
+		<< " bytes, pinned " << pinnedUsage << " bytes" << std::endl;
+}
+
+// PlainTable read through mmap, with a hash index on the key prefix; the prefix is the whole fixed-width
+// key unless prefixLen is shorter. It cannot store range tombstones and scans need total order, so it
+// runs in the point drivers with the tombstones kept in the memtable or with lazy range deletes.
+inline rocksdb::Status configurePlainTable(rocksdb::Options* options, int keyLen, int prefixLen) {
+	if (options->use_direct_reads) {
+		return rocksdb::Status::InvalidArgument("mmap reads cannot be combined with direct reads");
+	}
+	rocksdb::PlainTableOptions plainOptions;
+	plainOptions.user_key_len = keyLen;
+	options->table_factory.reset(rocksdb::NewPlainTableFactory(plainOptions));
+	options->allow_mmap_reads = true;
+	options->prefix_extractor.reset(rocksdb::NewFixedPrefixTransform(prefixLen > 0 ? prefixLen : keyLen));
+	return rocksdb::Status::OK();
+}
+
+// memory held for reads: table readers (PlainTable keeps its index there), block cache and memtables;
+// with mmap reads the SST files are mapped as well
+inline void printTableMemory(rocksdb::DB* db, const std::string& info) {
+	uint64_t tableReadersMem = 0;
+	uint64_t blockCacheUsage = 0;
+	uint64_t memtableSize = 0;
+	uint64_t sstSize = 0;
+	db->GetIntProperty(rocksdb::DB::Properties::kEstimateTableReadersMem, &tableReadersMem);
+	db->GetIntProperty(rocksdb::DB::Properties::kBlockCacheUsage, &blockCacheUsage);
+	db->GetIntProperty(rocksdb::DB::Properties::kCurSizeAllMemTables, &memtableSize);
+	db->GetIntProperty(rocksdb::DB::Properties::kTotalSstFilesSize, &sstSize);
+	std::cout << "Read memory " << info << ": table readers " << tableReadersMem << " bytes, block cache " << blockCacheUsage
+		<< " bytes, memtables " << memtableSize << " bytes" << std::endl;
+	if (db->GetOptions().allow_mmap_reads) {std::cout << "SST bytes mapped " << info << ": " << sstSize << std::endl;}
+}
+
+// filter work of the Gets of one key class: valid, covered by a range delete, or never inserted
+// useful counts SST files the filter ruled out, positive the files it let the read into
+struct FilterCounters {
+	uint64_t numGets = 0;
+	uint64_t useful = 0;
+	uint64_t positive = 0;
+
+	// perf context counters before a Get
+	struct Snapshot {
+		uint64_t useful = rocksdb::get_perf_context()->bloom_sst_miss_count;
+		uint64_t positive = rocksdb::get_perf_context()->bloom_sst_hit_count;
+	};
+
+	// add the filter work done since the snapshot
+	void addSince(const Snapshot& snapshot) {
+		numGets++;
+		useful += rocksdb::get_perf_context()->bloom_sst_miss_count - snapshot.useful;
+		positive += rocksdb::get_perf_context()->bloom_sst_hit_count - snapshot.positive;
+	}
+
+	// for absent keys every positive is a false positive
+	void print(const std::string& info) const {
+		if (numGets == 0) {return;}
+		printf("Filter (%s): %llu Gets, useful %.3f per Get, positive %.3f per Get, positive rate %.4f\n", info.c_str(),
+			(unsigned long long)numGets, (double)useful / numGets, (double)positive / numGets,
+			useful + positive > 0 ? (double)positive / (useful + positive) : 0.0);
+	}
+};
+
+// total size of the filters of all live SST files, and the memory of the table readers holding them
+inline void printFilterMemory(rocksdb::DB* db, const std::string& info) {
+	rocksdb::TablePropertiesCollection props;
+	db->GetPropertiesOfAllTables(&props);
+	uint64_t filterSize = 0;
+	for (auto& entry : props) {filterSize += entry.second->filter_size;}
+	uint64_t tableReadersMem = 0;
+	db->GetIntProperty(rocksdb::DB::Properties::kEstimateTableReadersMem, &tableReadersMem);
+	std::cout << "Filter size " << info << ": " << filterSize << " bytes" << std::endl;
+	std::cout << "Table readers memory " << info << ": " << tableReadersMem << " bytes" << std::endl;
+}
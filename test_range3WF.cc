@@ -5,12 +5,39 @@
 #include <iostream>
 #include <set>
 #include <array>
+#include <vector>
+#include <utility>
+#include <memory>
 
 #include "rocksdb/db.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/options.h"
 #include "rocksdb/iostats_context.h"
 #include "rocksdb/perf_context.h"
+#include "rocksdb/convenience.h"
+
+#include "bench_flags.h"
+#include "lazy_range_delete.h"
+#include "reclaim_compaction.h"
+#include "range_del_collector.h"
+#include "deleted_range_cache.h"
+#include "partitioned_db.h"
+#include "lsm_shape.h"
+#include "compaction_style.h"
+#include "table_config.h"
+#include "cache_mode.h"
+#include "compression_config.h"
+#include "blob_config.h"
+#include "memtable_config.h"
+#include "perf_report.h"
+#include "phase_statistics.h"
+#include "hw_counters.h"
+#include "timeline_sampler.h"
+#include "alloc_profile.h"
+#include "io_accounting.h"
+#include "block_cache_trace.h"
+#include "memory_report.h"
+#include "space_report.h"
 
 using ROCKSDB_NAMESPACE::DB;
 using ROCKSDB_NAMESPACE::Options;
@@ -70,12 +97,16 @@ void warmUp(Status statusDB, DB* db, int rangeSize, int keyLen, int warmUpNum, s
 
 // To access members of a structure, use the dot operator
 // To access members of a structure through a pointer, use the arrow operator
-int main() {
+int main(int argc, char** argv) {
 	// initialize the database and the options
 	DB* db;
 	Options options;
+	// optimization, done first since OptimizeLevelStyleCompaction() resets the compaction style
+	options.IncreaseParallelism();
+	options.OptimizeLevelStyleCompaction();
 	// disable background & auto compactions
-	options.compaction_style = ROCKSDB_NAMESPACE::kCompactionStyleNone;
+	// the style stays leveled so that manual CompactRange still works, kCompactionStyleNone would turn it into a no-op
+	options.compaction_style = ROCKSDB_NAMESPACE::kCompactionStyleLevel;
 	options.disable_auto_compactions = true;
 	// flushing options, flush the memtable to file
 	rocksdb::FlushOptions FlOptions;
@@ -86,14 +117,205 @@ int main() {
 	clock_t startTime;
 	clock_t endTime;
 
-	// optimization
-	options.IncreaseParallelism();
-	options.OptimizeLevelStyleCompaction();
 	options.create_if_missing = true;  // create the DB if it is not already present
 
+	// assume that each character has size 1 byte, ensure that one key-value pair has 1024 bytes
+	int valueLen = 1012;  // the length of the values
+	int keyLen = 12;  // the length of each key
+
+	// command-line options, "--name=value"
+	BenchFlags flags(argc, argv);
+	// how range deletes are executed: "tombstone" calls DeleteRange,
+	// "lazy" keeps the deleted ranges in memory and lets a compaction filter drop the keys
+	std::string rangeDeleteMode = flags.getString("range_delete_mode", "tombstone");
+	// whether to compact exactly the deleted ranges after the reads, physically reclaiming the space,
+	// and then repeat the reads to see how much throughput comes back
+	bool isReclaimCompaction = flags.getBool("reclaim_compaction", false);
+	int maxSubcompactions = flags.getInt("max_subcompactions", 1);  // subcompactions of each CompactRange
+	std::shared_ptr<CompactionStatsListener> compactionListener = std::make_shared<CompactionStatsListener>();
+	options.listeners.push_back(compactionListener);
+	// mark SST files whose range tombstones cover at least this many keys per entry for compaction, 0 disables it
+	// when enabled, leveled auto compaction is switched on after the deletes and reads are timed until the tombstones are gone
+	double rangeDelCompactionDensity = flags.getDouble("range_del_compaction_density", 0.0);
+	int tombstoneWaitSeconds = flags.getInt("tombstone_wait_seconds", 60);  // give up waiting after this long
+	// answer Gets on keys covered by a recent DeleteRange from memory, keeping up to this many intervals, 0 disables it
+	int deletedRangeCacheSize = flags.getInt("deleted_range_cache_size", 0);
+	// map the key ranges to column families and execute range deletes of whole partitions as DropColumnFamily
+	bool isPartitioned = flags.getBool("column_family_partitions", false);
+	if (deletedRangeCacheSize > 0 && (rangeDeleteMode == "lazy" || isPartitioned)) {
+		// lazy deletes and dropped partitions write no tombstone, so the cache cannot order them against the writes
+		std::cout << "deleted_range_cache_size needs range_delete_mode=tombstone without column_family_partitions" << std::endl;
+		return 1;
+	}
+	// LSM shape: the level of the base data, its number of L0 files when that level is 0,
+	// and the level of the range tombstones; -1 keeps the layout the driver produces by itself
+	LsmShapeBuilder lsmShape(flags.getInt("data_level", -1), flags.getInt("data_l0_files", 1), flags.getInt("tombstone_level", -1));
+	bool isPrintLsmShape = flags.getBool("print_lsm_shape", false) || lsmShape.isDataPlaced() || lsmShape.isTombstonePlaced();
+	if (rangeDelCompactionDensity > 0.0) {
+		options.table_properties_collector_factories.push_back(
+			std::make_shared<RangeDelDensityCollectorFactory>(rangeDelCompactionDensity));
+	}
+	std::shared_ptr<DeletedRangeSet> deletedRanges = std::make_shared<DeletedRangeSet>();
+	if (rangeDeleteMode == "lazy") {
+		options.compaction_filter_factory = std::make_shared<LazyRangeDeleteFilterFactory>(deletedRanges);
+	}
+	// compaction style matrix: "level", "universal", "fifo" or "none", all with auto compactions on;
+	// empty keeps leveled compaction with auto compactions off
+	std::string compactionStyle = flags.getString("compaction_style", "");
+	int settleSeconds = flags.getInt("settle_seconds", 60);  // wait at most this long for background work after the load and the deletes
+	uint64_t fifoMaxBytes = (uint64_t)flags.getInt("fifo_max_size_mb", 4096) << 20;  // FIFO drops the oldest files above this
+	std::shared_ptr<WriteAmpListener> writeAmpListener = std::make_shared<WriteAmpListener>();
+	options.listeners.push_back(writeAmpListener);
+	if (!compactionStyle.empty()) {
+		Status styleStatus = applyCompactionStyle(&options, compactionStyle, fifoMaxBytes);
+		if (!styleStatus.ok()) {
+			std::cout << "Invalid compaction style: " << styleStatus.ToString() << std::endl;
+			return 1;
+		}
+	}
+	// compression matrix: one type for all levels or a comma-separated list per level, empty keeps the defaults
+	std::string compression = flags.getString("compression", "");
+	std::string compressionPerLevel = flags.getString("compression_per_level", "");
+	Status compressionStatus = configureCompression(&options, compression, compressionPerLevel);
+	if (!compressionStatus.ok()) {
+		std::cout << "Invalid compression: " << compressionStatus.ToString() << std::endl;
+		return 1;
+	}
+	// values compress to about this fraction of their size, 1 keeps the random strings
+	double valueCompressibility = flags.getDouble("value_compressibility", 1.0);
+	bool isCompressionReport = !compression.empty() || !compressionPerLevel.empty() || valueCompressibility < 1.0;
+	// key-value separation: values of at least min_blob_size bytes go to blob files, with optional blob garbage collection
+	bool isBlobFiles = flags.getBool("enable_blob_files", false);
+	configureBlobFiles(&options, isBlobFiles, (uint64_t)flags.getInt("min_blob_size", 0), flags.getBool("blob_gc", false),
+		flags.getDouble("blob_gc_age_cutoff", 0.25));
+	// table format sweep, every option defaults to RocksDB's own default
+	rocksdb::BlockBasedTableOptions tableOptions;
+	int prefixLen = flags.getInt("prefix_len", 0);  // prefix filter and hash index on the leading key digits, 0 disables them
+	Status formatStatus = configureTableFormat(&tableOptions, flags.getInt("block_size", (int)tableOptions.block_size),
+		flags.getInt("block_restart_interval", tableOptions.block_restart_interval), flags.getString("data_block_index", "binary"),
+		flags.getDouble("data_block_hash_ratio", tableOptions.data_block_hash_table_util_ratio), flags.getString("index_type", "binary"),
+		flags.getInt("format_version", (int)tableOptions.format_version), prefixLen > 0);
+	if (!formatStatus.ok()) {
+		std::cout << "Invalid table format: " << formatStatus.ToString() << std::endl;
+		return 1;
+	}
+	bool isReadCostReport = flags.getBool("report_read_cost", false);  // CPU and blocks per Get of each point read phase
+	configurePrefix(&options, prefixLen);
+	// filter sweep: "bloom" or "ribbon" at bits_per_key, empty keeps the tables without filters
+	std::string filterPolicy = flags.getString("filter", "");
+	Status filterStatus = configureFilter(&tableOptions, &options, filterPolicy, flags.getDouble("bits_per_key", 0.0),
+		flags.getBool("whole_key_filtering", true), flags.getBool("partition_filters", false),
+		flags.getBool("optimize_filters_for_hits", false));
+	if (!filterStatus.ok()) {
+		std::cout << "Invalid filter: " << filterStatus.ToString() << std::endl;
+		return 1;
+	}
+	int absentQueries = flags.getInt("absent_queries", 0);  // point reads on keys that were never inserted, after the reads after deletes
+	bool isFilterReport = !filterPolicy.empty() || absentQueries > 0;
+	// block cache sweep: "lru" or "hyper_clock" of block_cache_mb, empty keeps RocksDB's default cache
+	std::string blockCacheType = flags.getString("block_cache", "");
+	Status cacheStatus = configureBlockCache(&tableOptions, blockCacheType, (size_t)flags.getInt("block_cache_mb", 8) << 20,
+		flags.getInt("cache_shard_bits", -1), flags.getBool("cache_index_and_filter_blocks", false),
+		flags.getBool("pin_l0_filter_and_index_blocks", false));
+	if (!cacheStatus.ok()) {
+		std::cout << "Invalid block cache: " << cacheStatus.ToString() << std::endl;
+		return 1;
+	}
+	// cache temperature: "cold" or "warm" start every read phase from emptied caches, empty keeps the old behavior
+	std::string cacheMode = flags.getString("cache_mode", "");
+	Status cacheModeStatus = configureCacheMode(&options, &tableOptions, cacheMode);
+	if (!cacheModeStatus.ok()) {
+		std::cout << "Invalid cache mode: " << cacheModeStatus.ToString() << std::endl;
+		return 1;
+	}
+	bool isCacheReport = !blockCacheType.empty() || !cacheMode.empty();
+	// table factory: "block_based" or "plain", empty is block-based without the memory report
+	std::string tableType = flags.getString("table", "");
+	if (tableType == "plain") {
+		Status plainStatus = configurePlainTable(&options, keyLen, prefixLen);
+		if (!plainStatus.ok()) {
+			std::cout << "Invalid plain table: " << plainStatus.ToString() << std::endl;
+			return 1;
+		}
+		if (rangeDeleteMode == "tombstone" && (isFlush || lsmShape.isTombstonePlaced() || isReclaimCompaction
+				|| rangeDelCompactionDensity > 0.0)) {
+			std::cout << "PlainTable cannot store range tombstones, use range_delete_mode=lazy" << std::endl;
+			return 1;
+		}
+	}
+	else if (tableType.empty() || tableType == "block_based") {
+		// the table options are complete
+		options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(tableOptions));
+	}
+	else {
+		std::cout << "Invalid table: " << tableType << std::endl;
+		return 1;
+	}
+	bool isTableMemoryReport = !tableType.empty();
+	// memtable sweep: "skiplist", "vector" or "hash_skiplist" (needs prefix_len), and the memtable sizes;
+	// empty or 0 keep the defaults
+	std::string memtable = flags.getString("memtable", "");
+	int writeBufferSizeMb = flags.getInt("write_buffer_size_mb", 0);
+	Status memtableStatus = configureMemtable(&options, memtable, options.prefix_extractor != nullptr, writeBufferSizeMb,
+		flags.getInt("max_write_buffer_number", 0), flags.getDouble("memtable_prefix_bloom_size_ratio", 0.0));
+	if (!memtableStatus.ok()) {
+		std::cout << "Invalid memtable: " << memtableStatus.ToString() << std::endl;
+		return 1;
+	}
+	bool isMemtableReport = !memtable.empty() || writeBufferSizeMb > 0;
+	// scans cross prefixes, so they must not use the prefix filter
+	ReadOptions scanOptions;
+	scanOptions.total_order_seek = true;
+	// per-phase perf context as one named counter per line, total and per operation
+	bool isPerfReport = flags.getBool("perf_report", false);
+	bool isPerLevelPerfReport = flags.getBool("per_level_perf", false);  // and the per-level counters of the read phases
+	// DB-wide tickers and histograms per phase, including the background threads
+	if (flags.getBool("statistics", false)) {options.statistics = rocksdb::CreateDBStatistics();}
+	PhaseStatistics phaseStatistics(options.statistics);
+	HwCounters hwCounters(flags.getBool("hw_counters", false));  // CPU counters of the driver thread per phase
+	AllocProfile allocProfile(flags.getBool("alloc_profile", false));  // allocations per operation, engine and harness
+	// memtables, block cache, table readers and RSS per phase, with the change since the previous report
+	MemoryReport memoryReport(flags.getBool("memory_report", false), tableOptions.block_cache);
+	// stored bytes against exactly counted live keys after insertion, deletes and reclamation, scans every live key
+	bool isSpaceReport = flags.getBool("space_report", false);
+	// trace the block cache accesses of every read phase into this directory, empty disables it
+	std::string blockCacheTraceDir = flags.getString("block_cache_trace_dir", "");
+	// count reads, bytes and latency per file type and SST level through a wrapping file system
+	std::shared_ptr<IoAccountingFileSystem> ioAccountingFs;
+	std::unique_ptr<rocksdb::Env> ioAccountingEnv;  // must outlive the DB
+	if (flags.getBool("io_accounting", false)) {
+		ioAccountingFs = std::make_shared<IoAccountingFileSystem>(rocksdb::FileSystem::Default());
+		ioAccountingEnv = rocksdb::NewCompositeEnv(ioAccountingFs);
+		options.env = ioAccountingEnv.get();
+	}
+	// CSV time series of the completed operations and the DB state, empty disables it
+	std::string timelineFile = flags.getString("timeline_file", "");
+	int timelineIntervalMs = flags.getInt("timeline_interval_ms", 100);
+	std::string dbPath = flags.getString("db_path", kDBPath);  // where the DB lives, run_matrix.sh passes its own
+	flags.reportUnknown();
+	Status shapeStatus = lsmShape.validate(options.num_levels, isPartitioned, compactionStyle);
+	if (!shapeStatus.ok()) {
+		std::cout << "Invalid LSM shape: " << shapeStatus.ToString() << std::endl;
+		return 1;
+	}
+	// determine whether or not we are testing "many-small-range" or "a-few-large-range"
+	bool isManySmall = false;
+	// delete 3 big ranges, with a much higher deletion selectivity
+	bool isVeryBig = true;
+	// range read or point read
+	bool isPointQuery = false;
+	// PlainTable scans would need total order, which its prefix hash index does not offer
+	if (tableType == "plain" && !isPointQuery) {
+		std::cout << "PlainTable is supported by the point drivers only" << std::endl;
+		return 1;
+	}
+	// column families left over from an earlier run would all have to be opened, and range tombstones
+	// left in the WAL would fail the recovery flush into PlainTable files, so start from scratch
+	if (isPartitioned || tableType == "plain") {rocksdb::DestroyDB(dbPath, options);}
+
 	// open DB and check the status
 	printf("Opening the DB...\n");
-	Status statusDB = DB::Open(options, kDBPath, &db);
+	Status statusDB = DB::Open(options, dbPath, &db);
 	assert(statusDB.ok());  // make sure to check error
 	printf("DB opened.\n");
 
@@ -101,6 +323,7 @@ int main() {
 	rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableTimeAndCPUTimeExceptForMutex);
 	rocksdb::PerfContext perfContext; perfContext.Reset();
 	rocksdb::IOStatsContext ioContext; ioContext.Reset();
+	if (isPerLevelPerfReport) {rocksdb::get_perf_context()->EnablePerLevelPerfContext();}
 	bool showPerfStats = false;  // whether or not to show the stats info
 	bool showIOStats = true;
 
@@ -115,16 +338,12 @@ int main() {
 	// whether to warm-up
 	bool isWarmUpBefore = true;
 	bool isWarmUpAfter = true;
-	// determine whether or not we are testing "many-small-range" or "a-few-large-range"
-	bool isManySmall = false;
-	// delete 3 big ranges, with a much higher deletion selectivity
-	bool isVeryBig = true;
-	// range read or point read
-	bool isPointQuery = false;
+	if (cacheMode == "cold") {  // cold reads are measured right after the caches are emptied
+		isWarmUpBefore = false;
+		isWarmUpAfter = false;
+	}
+	if (!cacheMode.empty()) {std::cout << "Cache mode: " << cacheMode << std::endl;}
 
-	// assume that each character has size 1 byte, ensure that one key-value pair has 1024 bytes
-	int valueLen = 1012;  // the length of the values
-	int keyLen = 12;  // the length of each key
 	// workload & query basic config
 	int rangeSize = 1000000;  // the number of key-value pairs to generate
 	int numPointQueries = rangeSize/10;  // number of point queries to perform
@@ -138,33 +357,120 @@ int main() {
 	approxSizeRanges[0].start = fixDigit(keyLen, std::to_string(0));
 	approxSizeRanges[0].limit = fixDigit(keyLen, std::to_string(rangeSize - 1));
 
+	// range delete pattern, known before the load so that the partitions can follow it
+	std::string rangeDeleteStart;
+	std::string rangeDeleteEnd;
+	int rangeDelSize;  // number of elements in each range delete
+	int gapSize;  // maintaining a constant-sized gap between the deleted ranges
+	int numRangeDel;  // number of range deletes
+	int startTemp = rangeSize/100;  // initial starting point of the deletes
+	if (isManySmall) {  // many small-range deletes
+		rangeDelSize = rangeSize/20;
+		gapSize = rangeSize/10;
+		numRangeDel = 10;
+	}
+	else {
+		if (isVeryBig) {  // 3 big-range deletes
+			startTemp = rangeSize/10;
+			rangeDelSize = rangeSize/4;
+			gapSize = 3*rangeSize/10;
+			numRangeDel = 3;
+		}
+		else {  // 4 long-range deletes, but the total number of entries deleted is the same as many small-range deletes
+			rangeDelSize = rangeSize/8;
+			gapSize = 2*(rangeDelSize + rangeSize/100);
+			numRangeDel = 4;
+		}
+	}
+
+	// wrap the DB for the chosen experiment, the test below stays the same
+	PartitionedDB* partitionedDB = nullptr;  // kept to report the dropped partitions
+	if (isPartitioned) {
+		// the deleted ranges and the gaps between them become one column family each
+		std::vector<std::string> partitionBoundaries;
+		for (int i = 0; i < numRangeDel; i++) {
+			partitionBoundaries.push_back(fixDigit(keyLen, std::to_string(startTemp + i*gapSize)));
+			partitionBoundaries.push_back(fixDigit(keyLen, std::to_string(startTemp + i*gapSize + rangeDelSize)));
+		}
+		statusDB = PartitionedDB::Open(db, options, partitionBoundaries, &partitionedDB);
+		assert(statusDB.ok());  // make sure to check error
+		db = partitionedDB;
+		std::cout << "Column families for partitions: " << partitionedDB->numPartitions() << std::endl;
+	}
+	// the lazy wrapper intercepts DeleteRange and the reads
+	if (rangeDeleteMode == "lazy") {db = new LazyRangeDeleteDB(db, deletedRanges);}
+	DeletedRangeCacheDB* rangeCacheDB = nullptr;  // kept to report how many Gets it answered
+	if (deletedRangeCacheSize > 0) {
+		rangeCacheDB = new DeletedRangeCacheDB(db, deletedRangeCacheSize);
+		db = rangeCacheDB;
+	}
+	uint64_t sstSize = 0;  // total size of the live SST files of all column families
+	TimelineSampler timeline(db, timelineFile, timelineIntervalMs);
+	memoryReport.print(db, "after open");
+
 	// generate the workload, insert a range of distinct keys
 	double insertTotalTime = 0.0;  // the total runtime of insertion
+	int flushEvery = lsmShape.prepareLoad(db, rangeSize, keyLen + valueLen);  // flush after this many keys, 0 never
+	resetPerfContexts();
+	phaseStatistics.start();
+	hwCounters.start();
+	allocProfile.startPhase();
+	timeline.setPhase("insertion");
 	printf("Insertion started.\n");
 	for (int i = 0; i < rangeSize; i++) {
 		// set up the key
 		dataKey = fixDigit(keyLen, std::to_string(i));
 		// set up the value, which is a random string
-		dataValue = randomString(valueLen);
+		dataValue = (valueCompressibility < 1.0) ? compressibleString(valueLen, valueCompressibility) : randomString(valueLen);
 		// start time of this single operation
+		allocProfile.beginOp();
 		startTime = clock();
 		statusDB = db->Put(WriteOptions(), dataKey, dataValue);
 		endTime = clock();
+		allocProfile.endOp();
 		// end time of this single operation
 		insertTotalTime += (double)(endTime - startTime) / CLOCKS_PER_SEC;
+		timeline.countOp();
 		assert(statusDB.ok());  // make sure to check error
+		if (flushEvery > 0 && (i + 1) % flushEvery == 0) {db->Flush(FlOptions);}
+	}
+	hwCounters.stop();  // the reports after the timed loop are not counted
+	allocProfile.endPhase();
+	// flush the memtable data to file, a placed data level needs the data in files
+	if (isFlush || lsmShape.isDataPlaced()) {db->Flush(FlOptions);}
+	statusDB = lsmShape.placeData(db);
+	assert(statusDB.ok());  // make sure to check error
+	if (isPrintLsmShape) {printLsmShape(db, "after insertion");}
+	uint64_t userBytes = (uint64_t)rangeSize * (keyLen + valueLen);  // bytes written by the test itself
+	if (!compactionStyle.empty()) {
+		printf("Background work settled after insertion in %.6fs\n", waitForCompactions(db, settleSeconds));
+		printCompactionStyleSummary(db, compactionStyle, "after insertion", userBytes, *writeAmpListener);
 	}
-	// flush the memtable data to file
-	if (isFlush) {db->Flush(FlOptions);}
 	printf("Insertion time: %.6fs\n", insertTotalTime);
+	if (isPerfReport) {printPerfReport("insertion", "Put", rangeSize);}
+	phaseStatistics.print("insertion");
+	hwCounters.print("insertion", "Put", rangeSize);
+	allocProfile.print("insertion", "Put", rangeSize);
+	memoryReport.print(db, "insertion");
+	if (isCompressionReport || isBlobFiles || isMemtableReport) {printf("Insertion throughput: %.6f entries/s\n", rangeSize/insertTotalTime);}
 	std::cout << rangeSize << " key-value pairs inserted." << std::endl;
 	// obtain the file size
   	statusDB = db->GetApproximateSizes(SAoptions, db->DefaultColumnFamily(), approxSizeRanges.data(), 1, sizes.data());
 	assert(statusDB.ok());  // make sure to check error
 	std::cout << "Size after insertion: " << sizes[0] << " bytes" << std::endl;
+	db->GetAggregatedIntProperty(rocksdb::DB::Properties::kTotalSstFilesSize, &sstSize);
+	std::cout << "SST size after insertion: " << sstSize << " bytes" << std::endl;
+	if (isBlobFiles) {printBlobSpace(db, "after insertion");}
+	if (isMemtableReport) {printMemtableState(db, "after insertion");}
+	if (isCompressionReport) {printf("Compression ratio after insertion: %.3f\n", sstSize > 0 ? (double)userBytes / sstSize : 0.0);}
+	if (isFilterReport) {printFilterMemory(db, "after insertion");}
+	if (isTableMemoryReport) {printTableMemory(db, "after insertion");}
+	if (isSpaceReport) {printSpaceReport(db, "after insertion", rangeSize);}
 
+	if (!cacheMode.empty()) {printCacheReset(resetCaches(db, tableOptions.block_cache.get()), "before deletes");}
 	// perform some warm-up point queries here
 	if (isWarmUpBefore) {
+		timeline.setPhase("warm-up before deletes");
 		warmUp(statusDB, db, rangeSize, keyLen, numPointQueries/2, " before range deletes ");
 	}
 
@@ -176,12 +482,24 @@ int main() {
 	double rangeThroughPutBefore;
 	int countRangeReadBefore;
 	rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableTimeAndCPUTimeExceptForMutex);
-	perfContext.Reset();
-	ioContext.Reset();
+	resetPerfContexts();
+	phaseStatistics.start();
+	hwCounters.start();
+	allocProfile.startPhase();
+	if (ioAccountingFs != nullptr) {ioAccountingFs->reset();}
+	timeline.setPhase("before deletes");
+	if (!blockCacheTraceDir.empty()) {
+		statusDB = startBlockCacheTrace(db, blockCacheTraceDir, "before deletes");
+		if (!statusDB.ok()) {std::cout << "Block cache trace not started: " << statusDB.ToString() << std::endl;}
+	}
+	BlockCacheCounters cacheCountersStart = BlockCacheCounters::current();
+	double decompressStart = decompressSeconds();
+	uint64_t numPhaseOps = 0;  // Gets or Nexts of the phase, to normalize the perf counters
 	if (isPointQuery) {
 		// perform some random point queries
 		std::set<std::string> keyReadSetBefore;  // ensure that we do not repeatedly visit a key
 		int countPointBefore = 0;  // count the number of valid entries retrieved
+		FilterCounters filterValidBefore;  // filter work of the reads, all keys are valid here
 		double pointReadTotalTimeBefore = 0.0;  // total time of the point queries
 		printf("Point read before deletes started.\n");
 		for (int i = 0; i < numPointQueries; i++) {
@@ -190,40 +508,72 @@ int main() {
 			while (keyReadSetBefore.count(keyRead) != 0) {
 				keyRead = fixDigit(keyLen, std::to_string(rand() % rangeSize));
 			}
+			FilterCounters::Snapshot filterSnapshot;
+			allocProfile.beginOp();
 			startTime = clock();  // start time of this single operation
 			statusDB = db->Get(ReadOptions(), keyRead, &valueRead);
 			endTime = clock();  // end time of this single operation
+			allocProfile.endOp();
 			assert(statusDB.ok());  // make sure to check error
+			filterValidBefore.addSince(filterSnapshot);
+			timeline.countOp();
 			pointReadTotalTimeBefore += (double)(endTime - startTime) / CLOCKS_PER_SEC;
 			if (!statusDB.IsNotFound()) {countPointBefore++;}
 			keyReadSetBefore.insert(keyRead);
 		}
+		hwCounters.stop();
+		allocProfile.endPhase();
 		std::cout << "Point read before deletes count: " << countPointBefore << std::endl;
 		printf("Point queries runtime before deletes: %.6fs\n", pointReadTotalTimeBefore);
 		pointThroughPutBefore = countPointBefore/pointReadTotalTimeBefore;
+		numPhaseOps = numPointQueries;
 		printf("Point queries read throughput before deletes: %.6f entries/s\n", pointThroughPutBefore);
+		if (isFilterReport) {filterValidBefore.print("valid keys before deletes");}
+		if (isReadCostReport) {
+			printReadCost(BlockCacheCounters::current() - cacheCountersStart, numPointQueries, pointReadTotalTimeBefore, "before deletes");
+		}
 	}
 	else {  // TEST: range read before deletion
 		std::cout << "Range read from " << rangeQueryStart << " to " << rangeQueryEnd << std::endl;
-		rocksdb::Iterator* iter = db->NewIterator(rocksdb::ReadOptions());  // the iterator to traverse the data
+		rocksdb::Iterator* iter = db->NewIterator(scanOptions);  // the iterator to traverse the data
 		countRangeReadBefore = 0;
 		double rangeReadTotalTimeBefore = 0.0;  // total time of the range query
+		allocProfile.beginOp();
 		startTime = clock();  // start time of this operation
 		for (iter->Seek(rangeQueryStart); iter->Valid() && iter->key().ToString() < rangeQueryEnd; iter->Next()) {
 			endTime = clock();
+			allocProfile.endOp();
 			rangeReadTotalTimeBefore += (double)(endTime - startTime) / CLOCKS_PER_SEC;
 			countRangeReadBefore++;  // make sure the time taken for this increment is NOT counted
+			timeline.countOp();
+			allocProfile.beginOp();
 			startTime = clock();
 		}
 		endTime = clock();  // end time of this operation
+		allocProfile.endOp();
+		hwCounters.stop();
+		allocProfile.endPhase();
 		rangeReadTotalTimeBefore += (double)(endTime - startTime) / CLOCKS_PER_SEC;
 		std::cout << "Range read before deletes count: " << countRangeReadBefore << std::endl;
+		numPhaseOps = countRangeReadBefore;
 		printf("Range read runtime before deletes: %.6fs\n", rangeReadTotalTimeBefore);
 		rangeThroughPutBefore = countRangeReadBefore/rangeReadTotalTimeBefore;
 		printf("Range read throughput before deletes: %.6f entries/s\n", rangeThroughPutBefore);
 		assert(iter->status().ok()); // check for any errors found during the scan
 		delete iter;  // delete the iterator
 	}
+	if (isCacheReport) {
+		(BlockCacheCounters::current() - cacheCountersStart).print("before deletes");
+		printBlockCacheUsage(db, "before deletes");
+	}
+	if (isCompressionReport) {printf("Block decompression time before deletes: %.6fs\n", decompressSeconds() - decompressStart);}
+	if (!blockCacheTraceDir.empty()) {db->EndBlockCacheTrace();}
+	if (isPerfReport) {printPerfReport("before deletes", isPointQuery ? "Get" : "Next", numPhaseOps);}
+	if (isPerLevelPerfReport) {printPerLevelPerfReport("before deletes", isPointQuery ? "Get" : "Next", numPhaseOps);}
+	phaseStatistics.print("before deletes");
+	hwCounters.print("before deletes", isPointQuery ? "Get" : "Next", numPhaseOps);
+	allocProfile.print("before deletes", isPointQuery ? "Get" : "Next", numPhaseOps);
+	memoryReport.print(db, "before deletes");
 	// output perf context & iostats context results
 	rocksdb::SetPerfLevel(rocksdb::PerfLevel::kDisable);
 	if (showPerfStats) {
@@ -236,37 +586,20 @@ int main() {
 		std::cout << "iostats_context before deletes: " << std::endl;
 		std::cout << ioContext.ToString() << std::endl;
 	}
+	if (ioAccountingFs != nullptr) {ioAccountingFs->print(db, "before deletes");}
 
 	// implement range deletes
-	std::string rangeDeleteStart;
-	std::string rangeDeleteEnd;
-	int rangeDelSize;  // number of elements in each range delete
-	int gapSize;  // maintaining a constant-sized gap between the deleted ranges
-	int numRangeDel;  // number of range deletes
-	int startTemp = rangeSize/100;  // initial starting point of the deletes
-	if (isManySmall) {  // many small-range deletes
-		rangeDelSize = rangeSize/20;
-		gapSize = rangeSize/10;
-		numRangeDel = 10;
-	}
-	else {
-		if (isVeryBig) {  // 3 big-range deletes
-			startTemp = rangeSize/10;
-			rangeDelSize = rangeSize/4;
-			gapSize = 3*rangeSize/10;
-			numRangeDel = 3;
-		}
-		else {  // 4 long-range deletes, but the total number of entries deleted is the same as many small-range deletes
-			rangeDelSize = rangeSize/8;
-			gapSize = 2*(rangeDelSize + rangeSize/100);
-			numRangeDel = 4;
-		}
-	}
 	double rangeDelTotalTime = 0.0;  // total time of the deletes
+	lsmShape.rememberFiles(db);
+	std::vector<std::pair<std::string, std::string>> deletedRangeList;  // the deleted ranges, for compaction
 	// ranges to be deleted
 	rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableTimeAndCPUTimeExceptForMutex);
-	perfContext.Reset();
-	ioContext.Reset();
+	resetPerfContexts();
+	phaseStatistics.start();
+	hwCounters.start();
+	allocProfile.startPhase();
+	if (ioAccountingFs != nullptr) {ioAccountingFs->reset();}
+	timeline.setPhase("range deletes");
 	for (int i = 0; i < numRangeDel; i++) {
 		// set start (inclusive) and end (exclusive) of the range
 		// this can be confirmed by doing a full scan after the range deletes
@@ -274,23 +607,51 @@ int main() {
 		rangeDeleteStart = fixDigit(keyLen, std::to_string(startTemp));
 		rangeDeleteEnd = fixDigit(keyLen, std::to_string(startTemp + rangeDelSize));
 		// native range delete, creating a range tombstone
+		allocProfile.beginOp();
 		startTime = clock();  // start time of this operation
 		statusDB = db->DeleteRange(WriteOptions(), db->DefaultColumnFamily(), rangeDeleteStart, rangeDeleteEnd);
 		endTime = clock();  // end time of this operation
+		allocProfile.endOp();
 		assert(statusDB.ok());  // make sure to check error
 		rangeDelTotalTime += (double)(endTime - startTime) / CLOCKS_PER_SEC;
+		timeline.countOp();
 		std::cout << "RANGE DELETED [" << rangeDeleteStart << ", " << rangeDeleteEnd << ") " << std::endl;
+		deletedRangeList.push_back(std::make_pair(rangeDeleteStart, rangeDeleteEnd));
 		startTemp += gapSize;
 	}
-	// flush the memtable to file
-	if (isFlush) {db->Flush(FlOptions);}
+	hwCounters.stop();
+	allocProfile.endPhase();
+	// flush the memtable to file, a placed tombstone level needs the tombstones in a file
+	if (isFlush || lsmShape.isTombstonePlaced()) {db->Flush(FlOptions);}
+	statusDB = lsmShape.placeTombstones(db);
+	assert(statusDB.ok());  // make sure to check error
+	if (isPrintLsmShape) {printLsmShape(db, "after deletes");}
+	if (!compactionStyle.empty()) {
+		printf("Background work settled after deletes in %.6fs\n", waitForCompactions(db, settleSeconds));
+		printCompactionStyleSummary(db, compactionStyle, "after deletes", userBytes, *writeAmpListener);
+	}
 	printf("Range deletion time: %.6fs\n", rangeDelTotalTime);
 	std::cout << "Number of range deletes: " << numRangeDel << std::endl;
 	std::cout << "Number of entries in each range delete: " << rangeDelSize << std::endl;
+	if (partitionedDB != nullptr) {
+		std::cout << "Column families dropped: " << partitionedDB->numDroppedPartitions() << std::endl;
+	}
+	if (rangeDeleteMode == "lazy") {
+		std::cout << "Lazy range deletes kept in memory: " << deletedRanges->size() << " intervals" << std::endl;
+	}
 	// get the size info
 	statusDB = db->GetApproximateSizes(SAoptions, db->DefaultColumnFamily(), approxSizeRanges.data(), 1, sizes.data());
 	assert(statusDB.ok());  // make sure to check error
 	std::cout << "Size after deletes: " << sizes[0] << " bytes" << std::endl;
+	db->GetAggregatedIntProperty(rocksdb::DB::Properties::kTotalSstFilesSize, &sstSize);
+	std::cout << "SST size after deletes: " << sstSize << " bytes" << std::endl;
+	if (isBlobFiles) {printBlobSpace(db, "after deletes");}
+	if (isMemtableReport) {printMemtableState(db, "after deletes");}
+	if (isPerfReport) {printPerfReport("range deletes", "DeleteRange", numRangeDel);}
+	phaseStatistics.print("range deletes");
+	hwCounters.print("range deletes", "DeleteRange", numRangeDel);
+	allocProfile.print("range deletes", "DeleteRange", numRangeDel);
+	memoryReport.print(db, "range deletes");
 	// output perf context & iostats context results
 	rocksdb::SetPerfLevel(rocksdb::PerfLevel::kDisable);
 	if (showPerfStats) {
@@ -303,96 +664,252 @@ int main() {
 		std::cout << "iostats_context for range deletes: " << std::endl;
 		std::cout << ioContext.ToString() << std::endl;
 	}
+	if (ioAccountingFs != nullptr) {ioAccountingFs->print(db, "for range deletes");}
+	if (isSpaceReport) {printSpaceReport(db, "after deletes", rangeSize);}
 
-	// perform some warm-up point queries here
-	if (isWarmUpAfter) {
-		warmUp(statusDB, db, rangeSize, keyLen, numPointQueries/2, " after range deletes ");
+	// let leveled compaction pick up the marked files and read until the range tombstones are gone
+	if (rangeDelCompactionDensity > 0.0) {
+		// the NF runs still hold the tombstones in the memtable, the collector only sees them once flushed
+		statusDB = db->Flush(FlOptions);
+		assert(statusDB.ok());  // make sure to check error
+		std::cout << "SST files marked for compaction: " << countMarkedFiles(db) << std::endl;
+		std::cout << "Range tombstones in SST files: " << countRangeTombstones(db) << std::endl;
+		statusDB = db->SetOptions({{"disable_auto_compactions", "false"}});
+		assert(statusDB.ok());  // make sure to check error
+		phaseStatistics.start();
+		printf("Reads while compacting range tombstones started.\n");
+		TombstoneWindowResult window = measureTombstoneWindow(db,
+			[&]() {return fixDigit(keyLen, std::to_string(rand() % rangeSize));}, tombstoneWaitSeconds, 100);
+		if (window.isCleared) {printf("Time until range tombstones disappear: %.6fs\n", window.seconds);}
+		else {printf("Range tombstones still present after %.6fs\n", window.seconds);}
+		std::cout << "Point reads while compacting: " << window.numReads << std::endl;
+		printf("Point read latency while compacting: avg %.3fus, p50 %.3fus, p99 %.3fus, max %.3fus\n",
+			window.avgMicros, window.p50Micros, window.p99Micros, window.maxMicros);
+		phaseStatistics.print("while compacting range tombstones");
+		// no background work during the reads after deletes, as in the other runs
+		if (compactionStyle.empty()) {
+			statusDB = db->SetOptions({{"disable_auto_compactions", "true"}});
+			assert(statusDB.ok());  // make sure to check error
+		}
 	}
 
-	rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableTimeAndCPUTimeExceptForMutex);
-	perfContext.Reset();
-	ioContext.Reset();
-	if (isPointQuery) {
-		// point query after deletion
-		std::set<std::string> keyReadSetAfter;  // ensure that we do not repeatedly visit a key
-		int countPointValidAfter = 0;  // count the number of valid entries retrieved
-		int countPointInvalidAfter = 0;  // count the number of invalid entries retrieved
-		double pointReadTotalTimeAfter = 0.0;  // total time of the point queries
-		double validPointReadTotalTime = 0.0;  // total time of reading valid entries
-		double invalidPointReadTotalTime = 0.0;  // total time of reading invalid entries
-		// perform some random point queries after range deletes
-		printf("Point read after deletes started.\n");
-		for (int i = 0; i < numPointQueries; i++) {
-			keyRead = fixDigit(keyLen, std::to_string(rand() % rangeSize));
-			while (keyReadSetAfter.count(keyRead) != 0) {
+	// read after the deletes, and once more after the reclamation compaction if it is enabled
+	int numReadPassesAfter = isReclaimCompaction ? 2 : 1;
+	double throughPutAfterDeletes = 0.0;  // the throughput of the first pass, to see how much comes back
+	for (int pass = 0; pass < numReadPassesAfter; pass++) {
+		std::string phase = (pass == 0) ? "after deletes" : "after reclamation compaction";
+		if (pass > 0) {
+			// compact the deleted ranges down to the bottommost level to physically reclaim the space
+			// this is where lazy range deletes pay for their deletes, so both modes are timed the same way
+			ReclaimResult reclaim;
+			timeline.setPhase("reclamation compaction");
+			phaseStatistics.start();  // the compaction's I/O, before the read phase resets the statistics
+			printf("Reclamation compaction started.\n");
+			statusDB = reclaimDeletedRanges(db, deletedRangeList, maxSubcompactions, compactionListener.get(), &reclaim);
+			assert(statusDB.ok());  // make sure to check error
+			printf("Reclamation compaction time: %.6fs\n", reclaim.seconds);
+			std::cout << "Reclamation compaction jobs: " << reclaim.numCompactions << std::endl;
+			std::cout << "Reclamation compaction bytes read: " << reclaim.bytesRead << " bytes" << std::endl;
+			std::cout << "Reclamation compaction bytes written: " << reclaim.bytesWritten << " bytes" << std::endl;
+			std::cout << "Reclamation compaction records dropped: " << reclaim.recordsDropped << std::endl;
+			std::cout << "SST size before reclamation compaction: " << reclaim.sstSizeBefore << " bytes" << std::endl;
+			std::cout << "SST size after reclamation compaction: " << reclaim.sstSizeAfter << " bytes" << std::endl;
+			printf("Space freed by reclamation compaction: %lld bytes\n", (long long)reclaim.sstSizeBefore - (long long)reclaim.sstSizeAfter);
+			phaseStatistics.print("reclamation compaction");
+			statusDB = db->GetApproximateSizes(SAoptions, db->DefaultColumnFamily(), approxSizeRanges.data(), 1, sizes.data());
+			assert(statusDB.ok());  // make sure to check error
+			std::cout << "Size after reclamation compaction: " << sizes[0] << " bytes" << std::endl;
+			if (isBlobFiles) {printBlobSpace(db, "after reclamation compaction");}
+			if (isSpaceReport) {printSpaceReport(db, "after reclamation compaction", rangeSize);}
+		}
+
+		if (!cacheMode.empty()) {printCacheReset(resetCaches(db, tableOptions.block_cache.get()), phase);}
+		// perform some warm-up point queries here
+		if (isWarmUpAfter) {
+			timeline.setPhase("warm-up " + phase);
+			warmUp(statusDB, db, rangeSize, keyLen, numPointQueries/2, " " + phase + " ");
+		}
+
+		rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableTimeAndCPUTimeExceptForMutex);
+		resetPerfContexts();
+		phaseStatistics.start();
+		hwCounters.start();
+		allocProfile.startPhase();
+		if (ioAccountingFs != nullptr) {ioAccountingFs->reset();}
+		timeline.setPhase(phase);
+		if (!blockCacheTraceDir.empty()) {
+			statusDB = startBlockCacheTrace(db, blockCacheTraceDir, phase);
+			if (!statusDB.ok()) {std::cout << "Block cache trace not started: " << statusDB.ToString() << std::endl;}
+		}
+		BlockCacheCounters cacheCountersStart = BlockCacheCounters::current();
+		double decompressStart = decompressSeconds();
+		uint64_t numPhaseOps = 0;  // Gets or Nexts of the phase, to normalize the perf counters
+		if (isPointQuery) {
+			// point query after deletion
+			std::set<std::string> keyReadSetAfter;  // ensure that we do not repeatedly visit a key
+			int countPointValidAfter = 0;  // count the number of valid entries retrieved
+			int countPointInvalidAfter = 0;  // count the number of invalid entries retrieved
+			double pointReadTotalTimeAfter = 0.0;  // total time of the point queries
+			double validPointReadTotalTime = 0.0;  // total time of reading valid entries
+			double invalidPointReadTotalTime = 0.0;  // total time of reading invalid entries
+			FilterCounters filterValid;  // filter work of the reads of valid keys
+			FilterCounters filterCovered;  // and of keys covered by the range deletes
+			// perform some random point queries after range deletes
+			uint64_t shortCircuitedStart = (rangeCacheDB != nullptr) ? rangeCacheDB->numShortCircuited() : 0;
+			printf("Point read %s started.\n", phase.c_str());
+			for (int i = 0; i < numPointQueries; i++) {
 				keyRead = fixDigit(keyLen, std::to_string(rand() % rangeSize));
+				while (keyReadSetAfter.count(keyRead) != 0) {
+					keyRead = fixDigit(keyLen, std::to_string(rand() % rangeSize));
+				}
+				FilterCounters::Snapshot filterSnapshot;
+				allocProfile.beginOp();
+				startTime = clock();  // start time of this operation
+				statusDB = db->Get(ReadOptions(), keyRead, &valueRead);
+				endTime = clock();  // end time of this operation
+				allocProfile.endOp();
+				pointReadTotalTimeAfter += (double)(endTime - startTime) / CLOCKS_PER_SEC;
+				timeline.countOp();
+				if (!statusDB.IsNotFound()) {
+					assert(statusDB.ok());  // make sure to check error, ignore the case where the key is not found
+					validPointReadTotalTime += (double)(endTime - startTime) / CLOCKS_PER_SEC;
+					countPointValidAfter++;
+					filterValid.addSince(filterSnapshot);
+				}
+				else {
+					invalidPointReadTotalTime += (double)(endTime - startTime) / CLOCKS_PER_SEC;
+					countPointInvalidAfter++;
+					filterCovered.addSince(filterSnapshot);
+				}
+				keyReadSetAfter.insert(keyRead);
 			}
-			startTime = clock();  // start time of this operation
-			statusDB = db->Get(ReadOptions(), keyRead, &valueRead);
-			endTime = clock();  // end time of this operation
-			pointReadTotalTimeAfter += (double)(endTime - startTime) / CLOCKS_PER_SEC;
-			if (!statusDB.IsNotFound()) {
-				assert(statusDB.ok());  // make sure to check error, ignore the case where the key is not found
-				validPointReadTotalTime += (double)(endTime - startTime) / CLOCKS_PER_SEC;
-				countPointValidAfter++;
+			hwCounters.stop();
+			allocProfile.endPhase();
+			std::cout << "Point read (valid) " << phase << " count: " << countPointValidAfter << std::endl;
+			std::cout << "Point read (invalid) " << phase << " count: " << countPointInvalidAfter << std::endl;
+			printf("Point queries runtime %s: %.6fs\n", phase.c_str(), pointReadTotalTimeAfter);
+			printf("Time spent for reading valid entries: %.6fs\n", validPointReadTotalTime);
+			printf("Time spent for reading invalid entries: %.6fs\n", invalidPointReadTotalTime);
+			printf("Point queries average read throughput %s: %.6f entries/s\n", phase.c_str(), numPointQueries/pointReadTotalTimeAfter);
+			numPhaseOps = numPointQueries;
+			printf("Point queries read throughput (valid) %s: %.6f entries/s\n", phase.c_str(), countPointValidAfter/validPointReadTotalTime);
+			double pointThroughPutAfter = countPointInvalidAfter/invalidPointReadTotalTime;
+			printf("Point queries read throughput (invalid) %s: %.6f entries/s\n", phase.c_str(), pointThroughPutAfter);
+			if (rangeCacheDB != nullptr) {
+				std::cout << "Point read (invalid) answered by the deleted-range cache: "
+					<< rangeCacheDB->numShortCircuited() - shortCircuitedStart << std::endl;
 			}
+			if (isFilterReport) {
+				filterValid.print("valid keys " + phase);
+				filterCovered.print("covered keys " + phase);
+			}
+			if (isReadCostReport) {
+				printReadCost(BlockCacheCounters::current() - cacheCountersStart, numPointQueries, pointReadTotalTimeAfter, phase);
+			}
+			printf("Point queries average read throughput drop: %.2f percent\n", (pointThroughPutBefore - pointThroughPutAfter)/pointThroughPutBefore*100.0);
+			if (pass == 0) {throughPutAfterDeletes = pointThroughPutAfter;}
 			else {
-				invalidPointReadTotalTime += (double)(endTime - startTime) / CLOCKS_PER_SEC;
-				countPointInvalidAfter++;
+				printf("Point queries read throughput recovered: %.2f percent of the drop\n",
+					(pointThroughPutAfter - throughPutAfterDeletes)/(pointThroughPutBefore - throughPutAfterDeletes)*100.0);
 			}
-			keyReadSetAfter.insert(keyRead);
 		}
-		std::cout << "Point read (valid) after deletes count: " << countPointValidAfter << std::endl;
-		std::cout << "Point read (invalid) after deletes count: " << countPointInvalidAfter << std::endl;
-		printf("Point queries runtime after deletes: %.6fs\n", pointReadTotalTimeAfter);
-		printf("Time spent for reading valid entries: %.6fs\n", validPointReadTotalTime);
-		printf("Time spent for reading invalid entries: %.6fs\n", invalidPointReadTotalTime);
-		printf("Point queries average read throughput after deletes: %.6f entries/s\n", numPointQueries/pointReadTotalTimeAfter);
-		printf("Point queries read throughput (valid) after deletes: %.6f entries/s\n", countPointValidAfter/validPointReadTotalTime);
-		double pointThroughPutAfter = countPointInvalidAfter/invalidPointReadTotalTime;
-		printf("Point queries read throughput (invalid) after deletes: %.6f entries/s\n", pointThroughPutAfter);
-		printf("Point queries average read throughput drop: %.2f percent\n", (pointThroughPutBefore - pointThroughPutAfter)/pointThroughPutBefore*100.0);
-	}
-	else {  // range read after deletion
-		rocksdb::Iterator* iter = db->NewIterator(rocksdb::ReadOptions());  // the iterator to traverse the data
-		int countRangeReadValidAfter = 0;  // count valid keys 
-		int countRangeReadInvalidAfter;  // count invalid keys 
-		int countRangeReadTotalAfter = countRangeReadBefore;  // count all keys in range
-		double rangeReadTotalTimeAfter = 0.0;  // total time of the range query
-		startTime = clock();  // start time of this operation
-		for (iter->Seek(rangeQueryStart); iter->Valid() && iter->key().ToString() < rangeQueryEnd; iter->Next()) {
-			endTime = clock();
+		else {  // range read after deletion
+			rocksdb::Iterator* iter = db->NewIterator(scanOptions);  // the iterator to traverse the data
+			int countRangeReadValidAfter = 0;  // count valid keys 
+			int countRangeReadInvalidAfter;  // count invalid keys 
+			int countRangeReadTotalAfter = countRangeReadBefore;  // count all keys in range
+			double rangeReadTotalTimeAfter = 0.0;  // total time of the range query
+			allocProfile.beginOp();
+			startTime = clock();  // start time of this operation
+			for (iter->Seek(rangeQueryStart); iter->Valid() && iter->key().ToString() < rangeQueryEnd; iter->Next()) {
+				endTime = clock();
+				allocProfile.endOp();
+				rangeReadTotalTimeAfter += (double)(endTime - startTime) / CLOCKS_PER_SEC;
+				countRangeReadValidAfter++;  // make sure the time taken for such increments is NOT counted
+				timeline.countOp();
+				allocProfile.beginOp();
+				startTime = clock();
+			}
+			endTime = clock();  // end time of this operation
+			allocProfile.endOp();
+			hwCounters.stop();
+			allocProfile.endPhase();
 			rangeReadTotalTimeAfter += (double)(endTime - startTime) / CLOCKS_PER_SEC;
-			countRangeReadValidAfter++;  // make sure the time taken for such increments is NOT counted
-			startTime = clock();
+			countRangeReadInvalidAfter = countRangeReadTotalAfter - countRangeReadValidAfter;
+			numPhaseOps = countRangeReadValidAfter;
+			std::cout << "Range read (valid) " << phase << " count: " << countRangeReadValidAfter << std::endl;
+			std::cout << "Range read (invalid) " << phase << " count: " << countRangeReadInvalidAfter << std::endl;
+			std::cout << "Range read (total) " << phase << " count: " << countRangeReadTotalAfter << std::endl;
+			printf("Range read runtime %s: %.6fs\n", phase.c_str(), rangeReadTotalTimeAfter);
+			double rangeThroughPutAfter = countRangeReadValidAfter/rangeReadTotalTimeAfter;
+			printf("Range read average throughput %s: %.6f entries/s\n", phase.c_str(), rangeThroughPutAfter);
+			printf("Range read average read throughput drop: %.2f percent\n", (rangeThroughPutBefore - rangeThroughPutAfter)/rangeThroughPutBefore*100.0);
+			if (pass == 0) {throughPutAfterDeletes = rangeThroughPutAfter;}
+			else {
+				printf("Range read throughput recovered: %.2f percent of the drop\n",
+					(rangeThroughPutAfter - throughPutAfterDeletes)/(rangeThroughPutBefore - throughPutAfterDeletes)*100.0);
+			}
+			assert(iter->status().ok());  // check for any errors found during the scan
+			delete iter;  // delete the iterator
 		}
-		endTime = clock();  // end time of this operation
-		rangeReadTotalTimeAfter += (double)(endTime - startTime) / CLOCKS_PER_SEC;
-		countRangeReadInvalidAfter = countRangeReadTotalAfter - countRangeReadValidAfter;
-		std::cout << "Range read (valid) after deletes count: " << countRangeReadValidAfter << std::endl;
-		std::cout << "Range read (invalid) after deletes count: " << countRangeReadInvalidAfter << std::endl;
-		std::cout << "Range read (total) after deletes count: " << countRangeReadTotalAfter << std::endl;
-		printf("Range read runtime after deletes: %.6fs\n", rangeReadTotalTimeAfter);
-		double rangeThroughPutAfter = countRangeReadValidAfter/rangeReadTotalTimeAfter;
-		printf("Range read average throughput after deletes: %.6f entries/s\n", rangeThroughPutAfter);
-		printf("Range read average read throughput drop: %.2f percent\n", (rangeThroughPutBefore - rangeThroughPutAfter)/rangeThroughPutBefore*100.0);
-		assert(iter->status().ok());  // check for any errors found during the scan
-		delete iter;  // delete the iterator
-	}
-	// output perf context & iostats context results
-	rocksdb::SetPerfLevel(rocksdb::PerfLevel::kDisable);
-	if (showPerfStats) {
-		perfContext = *(rocksdb::get_perf_context());
-		std::cout << "perf_context after deletes: " << std::endl;
-		std::cout << perfContext.ToString() << std::endl;
-	}
-	if (showIOStats) {
-		ioContext = *(rocksdb::get_iostats_context());
-		std::cout << "iostats_context after deletes: " << std::endl;
-		std::cout << ioContext.ToString() << std::endl;
+		// TEST: point read on keys that were never inserted, where only the filters save work
+		if (absentQueries > 0) {
+			FilterCounters filterAbsent;
+			double absentReadTotalTime = 0.0;  // total time of the absent-key reads
+			hwCounters.resume();
+			allocProfile.resumePhase();
+			for (int i = 0; i < absentQueries; i++) {
+				// between two inserted keys, so inside the key range of the SST files and up to the filter:
+				// ':' sorts right after '9'
+				keyRead = fixDigit(keyLen, std::to_string(rand() % rangeSize));
+				keyRead.back() = ':';
+				FilterCounters::Snapshot filterSnapshot;
+				allocProfile.beginOp();
+				startTime = clock();  // start time of this operation
+				statusDB = db->Get(ReadOptions(), keyRead, &valueRead);
+				endTime = clock();  // end time of this operation
+				allocProfile.endOp();
+				assert(statusDB.IsNotFound());  // make sure to check error
+				absentReadTotalTime += (double)(endTime - startTime) / CLOCKS_PER_SEC;
+				filterAbsent.addSince(filterSnapshot);
+				timeline.countOp();
+			}
+			hwCounters.stop();
+			allocProfile.endPhase();
+			printf("Point queries read throughput (absent) %s: %.6f entries/s\n", phase.c_str(), absentQueries/absentReadTotalTime);
+			filterAbsent.print("absent keys " + phase);
+			numPhaseOps += absentQueries;
+		}
+		if (isCacheReport) {
+			(BlockCacheCounters::current() - cacheCountersStart).print(phase);
+			printBlockCacheUsage(db, phase);
+		}
+		if (isTableMemoryReport) {printTableMemory(db, phase);}
+		if (isCompressionReport) {printf("Block decompression time %s: %.6fs\n", phase.c_str(), decompressSeconds() - decompressStart);}
+		if (!blockCacheTraceDir.empty()) {db->EndBlockCacheTrace();}
+		if (isPerfReport) {printPerfReport(phase, isPointQuery ? "Get" : "Next", numPhaseOps);}
+		if (isPerLevelPerfReport) {printPerLevelPerfReport(phase, isPointQuery ? "Get" : "Next", numPhaseOps);}
+		phaseStatistics.print(phase);
+		hwCounters.print(phase, isPointQuery ? "Get" : "Next", numPhaseOps);
+		allocProfile.print(phase, isPointQuery ? "Get" : "Next", numPhaseOps);
+		memoryReport.print(db, phase);
+		// output perf context & iostats context results
+		rocksdb::SetPerfLevel(rocksdb::PerfLevel::kDisable);
+		if (showPerfStats) {
+			perfContext = *(rocksdb::get_perf_context());
+			std::cout << "perf_context " << phase << ": " << std::endl;
+			std::cout << perfContext.ToString() << std::endl;
+		}
+		if (showIOStats) {
+			ioContext = *(rocksdb::get_iostats_context());
+			std::cout << "iostats_context " << phase << ": " << std::endl;
+			std::cout << ioContext.ToString() << std::endl;
+		}
+		if (ioAccountingFs != nullptr) {ioAccountingFs->print(db, phase);}
 	}
 	
 	// delete the database and end the test
+	timeline.stop();
 	delete db;
 	return 0;
 }
\ No newline at end of file
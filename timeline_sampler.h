@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "rocksdb/db.h"
+
+// Timeline of the run: a background thread samples, every intervalMs, the operations the driver
+// completed since the last sample and the DB state that explains dips in between, running flushes
+// and compactions, memtable size and the delayed write rate. The samples go to a CSV file:
+// time_ms,phase,ops,ops_per_sec,running_flushes,running_compactions,memtable_bytes,delayed_write_rate
+// An empty path disables the sampler; countOp() is then just a relaxed increment.
+
+class TimelineSampler {
+public:
+	TimelineSampler(rocksdb::DB* db, const std::string& path, int intervalMs)
+		: db_(db), intervalMs_(intervalMs > 0 ? intervalMs : 100) {
+		if (path.empty()) {return;}
+		file_ = fopen(path.c_str(), "w");
+		if (file_ == nullptr) {
+			printf("Cannot open the timeline file %s\n", path.c_str());
+			return;
+		}
+		fprintf(file_, "time_ms,phase,ops,ops_per_sec,running_flushes,running_compactions,memtable_bytes,delayed_write_rate\n");
+		start_ = std::chrono::steady_clock::now();
+		thread_ = std::thread([this]() {run();});
+	}
+
+	~TimelineSampler() {stop();}
+
+	TimelineSampler(const TimelineSampler&) = delete;
+	TimelineSampler& operator=(const TimelineSampler&) = delete;
+
+	void countOp() {ops_.fetch_add(1, std::memory_order_relaxed);}
+
+	void setPhase(const std::string& phase) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		phase_ = phase;
+	}
+
+	// call before the DB is deleted
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (isStopped_) {return;}
+			isStopped_ = true;
+		}
+		wakeUp_.notify_all();
+		if (thread_.joinable()) {thread_.join();}
+		if (file_ != nullptr) {
+			fclose(file_);
+			file_ = nullptr;
+		}
+	}
+
+private:
+	void run() {
+		uint64_t lastOps = 0;
+		std::chrono::steady_clock::time_point last = start_;
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (!wakeUp_.wait_for(lock, std::chrono::milliseconds(intervalMs_), [this]() {return isStopped_;})) {
+			std::string phase = phase_;
+			lock.unlock();
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			uint64_t ops = ops_.load(std::memory_order_relaxed);
+			uint64_t runningFlushes = 0;
+			uint64_t runningCompactions = 0;
+			uint64_t memtableBytes = 0;
+			uint64_t delayedWriteRate = 0;
+			db_->GetIntProperty(rocksdb::DB::Properties::kNumRunningFlushes, &runningFlushes);
+			db_->GetIntProperty(rocksdb::DB::Properties::kNumRunningCompactions, &runningCompactions);
+			db_->GetIntProperty(rocksdb::DB::Properties::kCurSizeAllMemTables, &memtableBytes);
+			db_->GetIntProperty(rocksdb::DB::Properties::kActualDelayedWriteRate, &delayedWriteRate);
+			double seconds = std::chrono::duration<double>(now - last).count();
+			fprintf(file_, "%lld,%s,%llu,%.1f,%llu,%llu,%llu,%llu\n",
+				(long long)std::chrono::duration_cast<std::chrono::milliseconds>(now - start_).count(), phase.c_str(),
+				(unsigned long long)(ops - lastOps), seconds > 0.0 ? (ops - lastOps) / seconds : 0.0,
+				(unsigned long long)runningFlushes, (unsigned long long)runningCompactions,
+				(unsigned long long)memtableBytes, (unsigned long long)delayedWriteRate);
+			lastOps = ops;
+			last = now;
+			lock.lock();
+		}
+	}
+
+	rocksdb::DB* db_;
+	int intervalMs_;
+	FILE* file_ = nullptr;
+	std::chrono::steady_clock::time_point start_;
+	std::atomic<uint64_t> ops_{0};
+	std::mutex mutex_;  // guards phase_ and isStopped_
+	std::condition_variable wakeUp_;
+	std::string phase_ = "setup";
+	bool isStopped_ = false;
+	std::thread thread_;
+};